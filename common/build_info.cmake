@@ -0,0 +1,20 @@
+# Build description recorded in result files (common/results.h): the git
+# revision at configure time and the compiler flags of the build type
+execute_process(
+    COMMAND git describe --always --dirty
+    WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+    OUTPUT_VARIABLE BENCH_GIT_HASH
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    ERROR_QUIET)
+if(NOT BENCH_GIT_HASH)
+    set(BENCH_GIT_HASH "unknown")
+endif()
+
+string(TOUPPER "${CMAKE_BUILD_TYPE}" _bench_build_type)
+set(BENCH_BUILD_FLAGS "${CMAKE_BUILD_TYPE} ${CMAKE_CXX_FLAGS} ${CMAKE_CXX_FLAGS_${_bench_build_type}} clock=${BENCH_CLOCK}")
+string(REGEX REPLACE " +" " " BENCH_BUILD_FLAGS "${BENCH_BUILD_FLAGS}")
+string(STRIP "${BENCH_BUILD_FLAGS}" BENCH_BUILD_FLAGS)
+
+add_compile_definitions(
+    BENCH_GIT_HASH="${BENCH_GIT_HASH}"
+    BENCH_BUILD_FLAGS="${BENCH_BUILD_FLAGS}")
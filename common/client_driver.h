@@ -0,0 +1,389 @@
+/*
+ * Run modes shared by the socket and gRPC clients
+ * Each client parses its options into ClientOptions, sets up its transport
+ * and hands over to one of the drivers here: run_replay_mode() for trace
+ * replay and open-loop runs, run_closed_loop() for warm-up, steady state
+ * and the measured epochs. The transport supplies how a call is made and
+ * the result-record fields that describe it; everything else, including
+ * the printed reports and record layout, is the same for both clients.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "clock.h"
+#include "cpu_usage.h"
+#include "perf_counters.h"
+#include "replay.h"
+#include "results.h"
+#include "schedstat.h"
+#include "startup_timer.h"
+#include "steady_state.h"
+#include "trace_file.h"
+#include "workload.h"
+
+// Options common to every client, as parsed from the command line
+struct ClientOptions {
+    int iterations = 1;
+    int bytes = 10;
+    bool log_output = true;
+    int startup_fd = -1;
+    bool perf = false;
+    bool cpu_stats = false;
+    bool one_way = false;
+    bool sched_stats = false;
+    int warmup = 0;
+    double steady_cv = 0;
+    int epochs = 1;
+    std::string cpu_list;
+    Workload workload;
+    std::string replay_path;
+    int replay_threads = 0;
+    double rate = 0;
+    std::string output_path;
+    std::string label;
+    std::string trace_path;
+
+    bool replay_mode() const { return !replay_path.empty() || rate > 0; }
+};
+
+// Adds the transport's own fields (mode, address, ...) to a result record
+typedef std::function<void(ResultRecord&)> RecordFields;
+
+// Replay and open-loop runs have their own loop without warm-up, epochs or
+// per-call instrumentation, so these options would be silently ignored
+inline bool check_replay_options(const ClientOptions& options) {
+    if (!options.replay_mode()) {
+        return true;
+    }
+    const char* unsupported = !options.trace_path.empty() ? "-T" : options.perf ? "-P" :
+                              options.cpu_stats ? "-C" : options.sched_stats ? "-D" :
+                              options.one_way ? "-O" : options.warmup > 0 ? "-W" :
+                              options.steady_cv > 0 ? "-V" : options.epochs > 1 ? "-E" :
+                              options.startup_fd >= 0 ? "-S" : NULL;
+    if (unsupported != NULL) {
+        fprintf(stderr, "Error: %s cannot be combined with -R or -r\n", unsupported);
+        return false;
+    }
+    return true;
+}
+
+// The run-mode lines of the client's log header
+inline void print_run_plan(const ClientOptions& options) {
+    if (!options.replay_path.empty()) {
+        std::cout << "Replay trace: " << options.replay_path << std::endl;
+    } else if (options.rate > 0) {
+        std::cout << "Open loop: " << options.iterations << " requests at " << options.rate
+                  << " per second" << std::endl;
+    } else {
+        std::cout << "Iterations: " << options.iterations << std::endl;
+        if (options.workload.enabled()) {
+            std::cout << "Workload: " << options.workload.spec() << std::endl;
+        } else {
+            std::cout << "Bytes per call: " << options.bytes << std::endl;
+        }
+    }
+}
+
+// Every call's request size, drawn before anything is timed
+inline std::vector<uint32_t> sample_sizes(const ClientOptions& options) {
+    return options.workload.enabled() ? options.workload.Sample(options.iterations)
+                                      : std::vector<uint32_t>(options.iterations, options.bytes);
+}
+
+/*
+ * Replay a request trace or an open-loop schedule instead of the fixed loop.
+ * make_caller is called once per replay thread and returns that thread's
+ * bool(uint32_t bytes) exchange, so each thread gets its own client.
+ */
+template <typename MakeCaller>
+int run_replay_mode(const ClientOptions& options, const char* transport, MakeCaller make_caller,
+                    const RecordFields& add_fields) {
+    std::vector<ReplayRequest> requests;
+    if (!options.replay_path.empty() && !load_replay_trace(options.replay_path, &requests)) {
+        return 1;
+    }
+    if (options.replay_path.empty()) {
+        requests = make_rate_schedule(sample_sizes(options), options.rate,
+                                      options.replay_threads > 0 ? options.replay_threads : 1);
+    }
+    BenchClock::Init();
+    int threads = options.replay_threads > 0 ? options.replay_threads : replay_clients(requests);
+    std::vector<ReplayOutcome> outcomes = run_replay(requests, threads, make_caller);
+    std::vector<uint64_t> latencies = print_replay_report(stdout, outcomes, threads);
+
+    uint64_t first = UINT64_MAX, last = 0, total_bytes = 0;
+    for (const ReplayOutcome& outcome : outcomes) {
+        first = std::min(first, outcome.scheduled_ns);
+        last = std::max(last, outcome.end_ns);
+        total_bytes += outcome.bytes;
+    }
+    double seconds = last > first ? (last - first) / 1e9 : 0;
+    if (options.rate > 0) {
+        printf("open_loop target_per_s %.0f achieved_per_s %.0f\n", options.rate,
+               seconds > 0 ? latencies.size() / seconds : 0.0);
+    }
+
+    if (!options.output_path.empty()) {
+        ResultRecord record;
+        record.Add("transport", transport);
+        record.Add("label", options.label);
+        add_fields(record);
+        record.Add("replay", options.replay_path.empty() ? "none" : options.replay_path);
+        record.Add("rate", options.rate);
+        record.Add("threads", static_cast<uint64_t>(threads));
+        record.Add("cpu", options.cpu_list.empty() ? "any" : options.cpu_list);
+        record.Add("bytes", static_cast<uint64_t>(total_bytes / outcomes.size()));
+        record.Add("iterations", static_cast<uint64_t>(outcomes.size()));
+        record.Add("successful", static_cast<uint64_t>(latencies.size()));
+        record.Add("total_ns", last - first);
+        record.Add("requests_per_s", seconds > 0 ? latencies.size() / seconds : 0.0);
+        record.Add("mb_per_s", seconds > 0 ? total_bytes / (1024.0 * 1024) / seconds : 0.0);
+        add_latency_percentiles(record, latencies);
+        record.Add("client_max_rss_kb", max_rss_kb());
+        add_run_metadata(record);
+        record.AppendTo(options.output_path);
+    }
+    return latencies.size() == outcomes.size() ? 0 : 1;
+}
+
+/*
+ * The closed loop: warm-up, steady state, then options.epochs timed passes
+ * over the sampled sizes. call(bytes, log) makes one exchange on client and
+ * returns whether it succeeded; client also provides the server CPU and
+ * scheduler queries and the one-way latency split. The client and the perf
+ * counters are set up by the caller, so startup covers the transport.
+ */
+template <typename Client, typename Call>
+int run_closed_loop(const ClientOptions& options, const char* transport, Client& client, Call call,
+                    StartupReport& startup, PerfCounters& perf_counters, const RecordFields& add_fields) {
+    const int iterations = options.iterations;
+    const int epochs = options.epochs;
+    const Workload& workload = options.workload;
+    BenchClock::Init();
+
+    std::vector<uint32_t> sizes = sample_sizes(options);
+    uint64_t epoch_bytes = 0;
+    for (uint32_t size : sizes) {
+        epoch_bytes += size;
+    }
+    double mean_bytes = static_cast<double>(epoch_bytes) / iterations;
+
+    // Startup ends with the first response, whether from warm-up or the
+    // first measured epoch
+    uint64_t first_response_ns = 0;
+    auto mark_first_response = [&]() {
+        if (first_response_ns == 0) {
+            first_response_ns = startup_monotonic_ns();
+            startup.Mark("first_response", first_response_ns);
+            startup.Finish();
+        }
+    };
+
+    // Untimed warm-up calls, then batches until the per-call time is steady
+    int warmup_calls = 0;
+    for (; warmup_calls < options.warmup; ++warmup_calls) {
+        call(sizes[warmup_calls % iterations], false);
+        mark_first_response();
+    }
+    SteadyStateDetector steady_state(options.steady_cv / 100);
+    if (options.steady_cv > 0) {
+        int batch = std::min(std::max(iterations / 10, 1), 100);
+        while (!steady_state.done()) {
+            uint64_t batch_start = BenchClock::Now();
+            for (int i = 0; i < batch; ++i) {
+                call(sizes[(warmup_calls + i) % iterations], false);
+                mark_first_response();
+            }
+            warmup_calls += batch;
+            steady_state.Add(BenchClock::ToNs(BenchClock::Now() - batch_start) / static_cast<double>(batch));
+        }
+    }
+    if (options.one_way) {
+        client.EnableTimestamps(static_cast<size_t>(iterations) * epochs);
+    }
+
+    // CPU usage snapshots are taken outside the timed loop
+    CpuUsage client_cpu_before = read_cpu_usage();
+    CpuUsage server_cpu_before;
+    bool server_cpu = options.cpu_stats && client.GetServerCpuUsage(&server_cpu_before);
+    SchedStat client_sched_before;
+    SchedStat server_sched_before;
+    bool client_sched = options.sched_stats && read_sched_stat(&client_sched_before);
+    bool server_sched = options.sched_stats && client.GetServerSchedStat(&server_sched_before);
+
+    uint64_t total_calls = static_cast<uint64_t>(iterations) * epochs;
+    bool in_process = options.warmup > 0 || options.steady_cv > 0 || epochs > 1;
+    if (in_process) {
+        printf("warm-up: %d calls", warmup_calls);
+        if (options.steady_cv > 0) {
+            printf(", %s after %d batches (cv %.2f%%)", steady_state.steady() ? "steady" : "not steady",
+                   steady_state.batches(), 100 * steady_state.cv());
+        }
+        printf("\n");
+    }
+
+    // Per-call latencies are only kept for the result record and the trace
+    bool record_latencies = !options.output_path.empty();
+    std::vector<uint64_t> latencies;
+    if (record_latencies) {
+        latencies.reserve(iterations);
+    }
+    TraceWriter trace;
+    if (!options.trace_path.empty() && !trace.Open(options.trace_path, total_calls, transport)) {
+        return 1;
+    }
+    SizeClassLatencies size_classes;
+    if (workload.enabled()) {
+        size_classes.Reserve(sizes, epochs);
+    }
+    bool time_calls = record_latencies || trace.enabled() || workload.enabled();
+
+    uint64_t successful_calls = 0;
+    uint64_t total_ns = 0;
+    uint64_t trace_start = BenchClock::Now();
+    perf_counters.Start();
+
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+        CpuUsage epoch_cpu_before = record_latencies ? read_cpu_usage() : CpuUsage();
+        int epoch_successful = 0;
+        latencies.clear();
+        uint64_t epoch_start = BenchClock::Now();
+
+        // Make the specified number of calls
+        for (int i = 0; i < iterations; ++i) {
+            if (options.log_output && iterations > 1) {
+                std::cout << "Call " << (i + 1) << "/" << iterations << ": ";
+            }
+
+            uint32_t call_bytes = sizes[i];
+            uint64_t call_start = time_calls ? BenchClock::Now() : 0;
+            bool ok = call(call_bytes, options.log_output);
+            if (ok) {
+                epoch_successful++;
+            }
+            if (time_calls) {
+                uint64_t call_ticks = BenchClock::Now() - call_start;
+                if (record_latencies) {
+                    latencies.push_back(call_ticks);
+                }
+                trace.Append(BenchClock::ToNs(call_start - trace_start), BenchClock::ToNs(call_ticks), call_bytes, ok);
+                if (workload.enabled() && ok) {
+                    size_classes.Add(call_bytes, BenchClock::ToNs(call_ticks));
+                }
+            }
+            mark_first_response();
+        }
+
+        uint64_t epoch_ns = BenchClock::ToNs(BenchClock::Now() - epoch_start);
+        successful_calls += epoch_successful;
+        total_ns += epoch_ns;
+        if (epochs > 1) {
+            printf("epoch %d/%d: %llu ns per call, %d/%d successful\n", epoch, epochs,
+                   static_cast<unsigned long long>(epoch_ns / iterations), epoch_successful, iterations);
+        }
+
+        // One record per epoch, so the analyzer sees epochs as runs
+        if (record_latencies) {
+            CpuUsage epoch_cpu = read_cpu_usage() - epoch_cpu_before;
+            for (uint64_t& latency : latencies) {
+                latency = BenchClock::ToNs(latency);
+            }
+            double seconds = epoch_ns / 1e9;
+            ResultRecord record;
+            record.Add("transport", transport);
+            record.Add("label", options.label);
+            add_fields(record);
+            record.Add("cpu", options.cpu_list.empty() ? "any" : options.cpu_list);
+            record.Add("bytes", static_cast<uint64_t>(mean_bytes + 0.5));
+            record.Add("workload", workload.enabled() ? workload.spec() : "fixed");
+            record.Add("iterations", static_cast<uint64_t>(iterations));
+            record.Add("successful", static_cast<uint64_t>(epoch_successful));
+            record.Add("total_ns", epoch_ns);
+            record.Add("requests_per_s", seconds > 0 ? epoch_successful / seconds : 0.0);
+            record.Add("mb_per_s", seconds > 0 ? epoch_successful * mean_bytes / (1024 * 1024) / seconds : 0.0);
+            add_latency_percentiles(record, latencies);
+            record.Add("epoch", static_cast<uint64_t>(epoch));
+            record.Add("epochs", static_cast<uint64_t>(epochs));
+            record.Add("warmup_calls", static_cast<uint64_t>(warmup_calls));
+            record.Add("startup_ns", first_response_ns - startup_constructor_ns);
+            record.Add("client_user_us", epoch_cpu.user_us);
+            record.Add("client_sys_us", epoch_cpu.sys_us);
+            record.Add("client_max_rss_kb", max_rss_kb());
+            record.Add("clock", BenchClock::Name());
+            add_run_metadata(record);
+            record.AppendTo(options.output_path);
+        }
+    }
+
+    perf_counters.Stop();
+    SchedStat client_sched_after;
+    client_sched = client_sched && read_sched_stat(&client_sched_after);
+    CpuUsage client_cpu = read_cpu_usage() - client_cpu_before;
+    trace.Close();
+
+    if (in_process) {
+        printf("startup: %llu us from process start to first response\n",
+               static_cast<unsigned long long>((first_response_ns - startup_constructor_ns) / 1000));
+    }
+
+    if (options.log_output) {
+        std::cout << "---" << std::endl;
+        std::cout << "Summary:" << std::endl;
+        std::cout << "Successful calls: " << successful_calls << "/" << total_calls << std::endl;
+        std::cout << "Total time: " << (total_ns / 1000) << " μs" << std::endl;
+        if (total_calls > 1) {
+            std::cout << "Average time per call: " << (total_ns / total_calls) << " ns" << std::endl;
+        }
+        std::cout << "Timer: " << BenchClock::Name() << ", "
+                  << BenchClock::ReadOverheadNs() << " ns per read" << std::endl;
+        std::cout << "Success rate: " << (100.0 * successful_calls / total_calls) << "%" << std::endl;
+    } else if (successful_calls != total_calls) {
+        // Failures are reported even in quiet mode so drivers can count them
+        std::cerr << "Failed calls: " << (total_calls - successful_calls) << "/" << total_calls << std::endl;
+    }
+
+    if (options.cpu_stats) {
+        uint64_t total_bytes = epoch_bytes * epochs;
+        print_cpu_efficiency(stdout, "client", client_cpu, total_calls, total_bytes);
+        CpuUsage server_cpu_after;
+        if (server_cpu && client.GetServerCpuUsage(&server_cpu_after)) {
+            print_cpu_efficiency(stdout, "server", server_cpu_after - server_cpu_before,
+                                 total_calls, total_bytes);
+        }
+    }
+
+    if (options.perf) {
+        print_perf_report(stdout, "client", perf_counters, perf_counters.Read(), total_calls);
+    }
+
+    if (options.one_way) {
+        client.latency_split().Print(stdout);
+    }
+
+    if (workload.enabled()) {
+        size_classes.Print(stdout);
+    }
+
+    if (options.sched_stats) {
+        SchedStat server_sched_after;
+        if (client_sched) {
+            print_sched_delay(stdout, "client", client_sched_after - client_sched_before, total_calls);
+        } else {
+            std::cerr << "Scheduler statistics unavailable (/proc/self/task/*/schedstat)" << std::endl;
+        }
+        if (server_sched && client.GetServerSchedStat(&server_sched_after)) {
+            print_sched_delay(stdout, "server", server_sched_after - server_sched_before, total_calls);
+        }
+    }
+
+    return (successful_calls == total_calls) ? 0 : 1;
+}
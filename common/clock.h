@@ -0,0 +1,142 @@
+/*
+ * Per-call benchmark clock
+ * Reads the TSC when the CPU reports it as invariant (constant rate, not
+ * stopped in idle states) and converts ticks to ns with a rate calibrated
+ * against CLOCK_MONOTONIC_RAW; otherwise reads CLOCK_MONOTONIC. The clock is
+ * picked at compile time with BENCH_CLOCK (CMake -DBENCH_CLOCK=tsc|monotonic)
+ * so the cost of the timer itself can be compared between builds.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+#define BENCH_CLOCK_MONOTONIC 1
+#define BENCH_CLOCK_TSC 2
+
+#ifndef BENCH_CLOCK
+#if BENCH_HAVE_TSC
+#define BENCH_CLOCK BENCH_CLOCK_TSC
+#else
+#define BENCH_CLOCK BENCH_CLOCK_MONOTONIC
+#endif
+#endif
+
+#if BENCH_CLOCK == BENCH_CLOCK_TSC && !BENCH_HAVE_TSC
+#error "BENCH_CLOCK_TSC requires an x86 CPU"
+#endif
+
+inline uint64_t clock_ns(clockid_t clock_id) {
+    struct timespec ts;
+    clock_gettime(clock_id, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// CPUID 0x80000007 EDX bit 8: the TSC ticks at a constant rate in all
+// P-, C- and T-states
+inline bool tsc_invariant() {
+#if BENCH_HAVE_TSC
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+// TSC ticks per ns, measured once against CLOCK_MONOTONIC_RAW over 10 ms;
+// 0 without a TSC
+inline double tsc_ticks_per_ns() {
+#if BENCH_HAVE_TSC
+    static const double rate = [] {
+        uint64_t start_ns = clock_ns(CLOCK_MONOTONIC_RAW);
+        uint64_t start_ticks = __rdtsc();
+        usleep(10000);
+        uint64_t end_ticks = __rdtsc();
+        uint64_t end_ns = clock_ns(CLOCK_MONOTONIC_RAW);
+        return static_cast<double>(end_ticks - start_ticks) / (end_ns - start_ns);
+    }();
+    return rate;
+#else
+    return 0.0;
+#endif
+}
+
+// Timestamps from Now() are opaque ticks; only differences converted with
+// ToNs() are meaningful
+class BenchClock {
+public:
+    // Calibrate up front so the first timed call does not pay for it
+    static void Init() {
+        State();
+    }
+
+    static uint64_t Now() {
+#if BENCH_CLOCK == BENCH_CLOCK_TSC
+        if (State().use_tsc) {
+            // Keep the read from moving ahead of the work before it
+            _mm_lfence();
+            return __rdtsc();
+        }
+#endif
+        return clock_ns(CLOCK_MONOTONIC);
+    }
+
+    static uint64_t ToNs(uint64_t ticks) {
+        return static_cast<uint64_t>(ticks * State().ns_per_tick);
+    }
+
+    static const char* Name() {
+#if BENCH_CLOCK == BENCH_CLOCK_TSC
+        return State().use_tsc ? "tsc" : "monotonic (TSC not invariant)";
+#else
+        return "monotonic";
+#endif
+    }
+
+    // Average cost of one Now() call
+    static double ReadOverheadNs() {
+        const int reads = 100000;
+        uint64_t sink = 0;
+        uint64_t start_ns = clock_ns(CLOCK_MONOTONIC);
+        for (int i = 0; i < reads; ++i) {
+            sink += Now();
+        }
+        uint64_t end_ns = clock_ns(CLOCK_MONOTONIC);
+        asm volatile("" : : "r"(sink));
+        return static_cast<double>(end_ns - start_ns) / reads;
+    }
+
+private:
+    struct Calibration {
+        bool use_tsc = false;
+        double ns_per_tick = 1.0;
+    };
+
+    static const Calibration& State() {
+        static const Calibration calibration = [] {
+            Calibration c;
+#if BENCH_CLOCK == BENCH_CLOCK_TSC
+            if (tsc_invariant()) {
+                c.use_tsc = true;
+                c.ns_per_tick = 1.0 / tsc_ticks_per_ns();
+            }
+#endif
+            return c;
+        }();
+        return calibration;
+    }
+};
@@ -0,0 +1,62 @@
+/*
+ * CPU pinning
+ * Parses CPU lists in the kernel's format ("0-3,8") and pins the calling
+ * thread to them. Threads created afterwards inherit the mask, so pinning
+ * first thing in main covers the whole process.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sched.h>
+
+inline bool parse_cpu_list(const std::string& list, cpu_set_t* set) {
+    CPU_ZERO(set);
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string range = list.substr(pos, end - pos);
+        char* rest;
+        long first = strtol(range.c_str(), &rest, 10);
+        long last = first;
+        if (rest == range.c_str()) {
+            return false;
+        }
+        if (*rest == '-') {
+            const char* second = rest + 1;
+            last = strtol(second, &rest, 10);
+            if (rest == second) {
+                return false;
+            }
+        }
+        if (*rest != '\0' || first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            CPU_SET(cpu, set);
+        }
+        pos = end + 1;
+    }
+    return CPU_COUNT(set) > 0;
+}
+
+// Pin to the CPUs in list; prints the reason and returns false on failure
+inline bool pin_to_cpus(const std::string& list) {
+    cpu_set_t set;
+    if (!parse_cpu_list(list, &set)) {
+        fprintf(stderr, "Error: invalid CPU list '%s'\n", list.c_str());
+        return false;
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        fprintf(stderr, "Failed to pin to CPUs %s: %s\n", list.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
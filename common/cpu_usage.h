@@ -0,0 +1,62 @@
+/*
+ * CPU time and context switch accounting from getrusage()
+ * Used to report CPU-microseconds per request and per MB for both sides
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <sys/resource.h>
+
+// Cumulative CPU usage of a process. Plain data so the socket server can
+// send it as a control reply.
+struct CpuUsage {
+    uint64_t user_us = 0;
+    uint64_t sys_us = 0;
+    uint64_t voluntary_switches = 0;
+    uint64_t involuntary_switches = 0;
+};
+
+inline CpuUsage read_cpu_usage() {
+    CpuUsage usage;
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        usage.user_us = static_cast<uint64_t>(ru.ru_utime.tv_sec) * 1000000 + ru.ru_utime.tv_usec;
+        usage.sys_us = static_cast<uint64_t>(ru.ru_stime.tv_sec) * 1000000 + ru.ru_stime.tv_usec;
+        usage.voluntary_switches = ru.ru_nvcsw;
+        usage.involuntary_switches = ru.ru_nivcsw;
+    }
+    return usage;
+}
+
+inline CpuUsage operator-(const CpuUsage& after, const CpuUsage& before) {
+    CpuUsage delta;
+    delta.user_us = after.user_us - before.user_us;
+    delta.sys_us = after.sys_us - before.sys_us;
+    delta.voluntary_switches = after.voluntary_switches - before.voluntary_switches;
+    delta.involuntary_switches = after.involuntary_switches - before.involuntary_switches;
+    return delta;
+}
+
+// Print one line of "key value" pairs for a run, e.g.
+//   client cpu_us_per_request 9.8 user_us 2.1 sys_us 7.7 cpu_us_per_mb 306.3 ...
+// Note getrusage() has the kernel's tick-based accounting resolution, so
+// runs should last well over a few milliseconds.
+inline void print_cpu_efficiency(FILE* out, const char* who, const CpuUsage& delta,
+                                 uint64_t requests, uint64_t bytes) {
+    if (requests == 0) {
+        requests = 1;
+    }
+    double cpu_us = static_cast<double>(delta.user_us + delta.sys_us);
+    double megabytes = static_cast<double>(bytes) / (1024 * 1024);
+
+    fprintf(out, "%s cpu_us_per_request %.3f user_us %llu sys_us %llu cpu_us_per_mb %.1f "
+                 "voluntary_switches_per_request %.3f involuntary_switches_per_request %.3f\n",
+            who, cpu_us / requests,
+            static_cast<unsigned long long>(delta.user_us),
+            static_cast<unsigned long long>(delta.sys_us),
+            megabytes > 0 ? cpu_us / megabytes : 0.0,
+            static_cast<double>(delta.voluntary_switches) / requests,
+            static_cast<double>(delta.involuntary_switches) / requests);
+}
@@ -0,0 +1,84 @@
+/*
+ * Log2-bucketed latency histogram
+ * Cheap enough to record on every request; percentiles are reported as the
+ * upper bound of the bucket they fall in
+ */
+
+#pragma once
+
+#include <cstdint>
+
+class Log2Histogram {
+public:
+    // Bucket b holds values in [2^(b-1), 2^b), bucket 0 holds 0
+    static const int kBuckets = 65;
+
+    static int BucketFor(uint64_t value) {
+        return value == 0 ? 0 : 64 - __builtin_clzll(value);
+    }
+
+    // Largest value that falls into the bucket
+    static uint64_t BucketUpperBound(int bucket) {
+        return bucket == 0 ? 0 : bucket >= 64 ? UINT64_MAX : (1ull << bucket) - 1;
+    }
+
+    void Record(uint64_t value) {
+        buckets_[BucketFor(value)]++;
+        count_++;
+        sum_ += value;
+        if (value > max_) {
+            max_ = value;
+        }
+    }
+
+    void Merge(const Log2Histogram& other) {
+        for (int b = 0; b < kBuckets; ++b) {
+            buckets_[b] += other.buckets_[b];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        if (other.max_ > max_) {
+            max_ = other.max_;
+        }
+    }
+
+    void Reset() {
+        *this = Log2Histogram();
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t max() const { return max_; }
+    uint64_t bucket(int b) const { return buckets_[b]; }
+
+    double Mean() const {
+        return count_ > 0 ? static_cast<double>(sum_) / count_ : 0.0;
+    }
+
+    // Upper bound of the bucket containing the given quantile (0..1),
+    // capped at the largest recorded value
+    uint64_t Percentile(double quantile) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(quantile * count_);
+        if (rank >= count_) {
+            rank = count_ - 1;
+        }
+        uint64_t seen = 0;
+        for (int b = 0; b < kBuckets; ++b) {
+            seen += buckets_[b];
+            if (seen > rank) {
+                uint64_t bound = BucketUpperBound(b);
+                return bound < max_ ? bound : max_;
+            }
+        }
+        return max_;
+    }
+
+private:
+    uint64_t buckets_[kBuckets] = {};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
@@ -0,0 +1,75 @@
+/*
+ * One-way latency split
+ * With server receive/send timestamps in the response, a round trip splits
+ * into request path (client send -> server read), service (server read ->
+ * server send) and response path (server send -> client has the response).
+ * All four timestamps are CLOCK_MONOTONIC on the same host.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+enum LatencyComponent {
+    LATENCY_REQUEST_PATH,
+    LATENCY_SERVICE,
+    LATENCY_RESPONSE_PATH,
+    NUM_LATENCY_COMPONENTS,
+};
+
+const char* const LATENCY_COMPONENT_NAMES[NUM_LATENCY_COMPONENTS] = {
+    "request_path_ns", "service_ns", "response_path_ns",
+};
+
+class LatencySplitStats {
+public:
+    // Room for calls stamped responses, so Add never reallocates between
+    // the client's send and receive timestamps
+    void Reserve(size_t calls) {
+        for (auto& component : components_) {
+            component.reserve(calls);
+        }
+    }
+
+    void Add(uint64_t client_send_ns, uint64_t server_receive_ns,
+             uint64_t server_send_ns, uint64_t client_receive_ns) {
+        components_[LATENCY_REQUEST_PATH].push_back(Elapsed(client_send_ns, server_receive_ns));
+        components_[LATENCY_SERVICE].push_back(Elapsed(server_receive_ns, server_send_ns));
+        components_[LATENCY_RESPONSE_PATH].push_back(Elapsed(server_send_ns, client_receive_ns));
+    }
+
+    size_t count() const { return components_[0].size(); }
+
+    // One line, e.g.
+    //   latency split: request_path_ns p50 4100 p99 9800 mean 4400 service_ns ... over 1000 calls
+    void Print(FILE* out) const {
+        if (count() == 0) {
+            fprintf(out, "latency split: no stamped responses\n");
+            return;
+        }
+        fprintf(out, "latency split:");
+        for (int c = 0; c < NUM_LATENCY_COMPONENTS; ++c) {
+            std::vector<uint64_t> values = components_[c];
+            std::sort(values.begin(), values.end());
+            double sum = 0;
+            for (uint64_t value : values) {
+                sum += value;
+            }
+            fprintf(out, " %s p50 %llu p99 %llu mean %.0f", LATENCY_COMPONENT_NAMES[c],
+                    static_cast<unsigned long long>(values[values.size() / 2]),
+                    static_cast<unsigned long long>(values[values.size() * 99 / 100]),
+                    sum / values.size());
+        }
+        fprintf(out, " over %zu calls\n", count());
+    }
+
+private:
+    std::vector<uint64_t> components_[NUM_LATENCY_COMPONENTS];
+
+    static uint64_t Elapsed(uint64_t from, uint64_t to) {
+        return to > from ? to - from : 0;
+    }
+};
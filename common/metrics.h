@@ -0,0 +1,243 @@
+/*
+ * Prometheus text exposition for the servers
+ * Metrics are relaxed atomics updated on the request path without locks; a
+ * scrape reads them while the server keeps running, so values of different
+ * metrics may be a few requests apart
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "histogram.h"
+
+// Log2-bucketed histogram that several threads can record into
+class AtomicHistogram {
+public:
+    void Record(uint64_t value) {
+        buckets_[Log2Histogram::BucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t bucket(int b) const { return buckets_[b].load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> buckets_[Log2Histogram::kBuckets] = {};
+    std::atomic<uint64_t> sum_{0};
+};
+
+// Builds a text exposition (format version 0.0.4)
+class MetricsText {
+public:
+    void Counter(const char* name, const char* help, double value) {
+        Header(name, help, "counter");
+        Sample(name, "", value);
+    }
+
+    void Gauge(const char* name, const char* help, double value) {
+        Header(name, help, "gauge");
+        Sample(name, "", value);
+    }
+
+    // Emits one le bucket per log2 bucket from first_bucket to last_bucket,
+    // smaller values are included in the first and larger ones only in +Inf.
+    // Values are multiplied by scale, e.g. 1e-9 to export ns as seconds.
+    void Histogram(const char* name, const char* help, const AtomicHistogram& histogram,
+                   int first_bucket, int last_bucket, double scale) {
+        Header(name, help, "histogram");
+        std::string bucket_name = std::string(name) + "_bucket";
+        uint64_t cumulative = 0;
+        for (int b = 0; b < Log2Histogram::kBuckets; ++b) {
+            cumulative += histogram.bucket(b);
+            if (b < first_bucket || b > last_bucket) {
+                continue;
+            }
+            char label[64];
+            snprintf(label, sizeof(label), "{le=\"%.9g\"}",
+                     Log2Histogram::BucketUpperBound(b) * scale);
+            Sample(bucket_name.c_str(), label, cumulative);
+        }
+        Sample(bucket_name.c_str(), "{le=\"+Inf\"}", cumulative);
+        Sample((std::string(name) + "_sum").c_str(), "", histogram.sum() * scale);
+        Sample((std::string(name) + "_count").c_str(), "", cumulative);
+    }
+
+    const std::string& str() const { return text_; }
+
+private:
+    std::string text_;
+
+    void Header(const char* name, const char* help, const char* type) {
+        text_ += std::string("# HELP ") + name + " " + help + "\n";
+        text_ += std::string("# TYPE ") + name + " " + type + "\n";
+    }
+
+    void Sample(const char* name, const char* labels, double value) {
+        // Counts are printed exactly, everything else with 9 significant digits
+        char line[256];
+        if (value == static_cast<double>(static_cast<int64_t>(value))) {
+            snprintf(line, sizeof(line), "%s%s %lld\n", name, labels, static_cast<long long>(value));
+        } else {
+            snprintf(line, sizeof(line), "%s%s %.9g\n", name, labels, value);
+        }
+        text_ += line;
+    }
+};
+
+// Metrics common to all servers. Transport-specific gauges (connections,
+// queue depth) are added by each server when rendering.
+struct ServerMetrics {
+    AtomicHistogram request_bytes;        // requested size, counts requests by size bucket
+    AtomicHistogram request_duration_ns;  // time to serve one request
+    std::atomic<uint64_t> bytes_served{0};
+    std::atomic<uint64_t> getrandom_calls{0};
+    std::atomic<uint64_t> getrandom_bytes{0};
+    std::atomic<uint64_t> getrandom_ns{0};
+    std::atomic<uint64_t> getrandom_errors{0};
+
+    void RecordRequest(uint64_t num_bytes, uint64_t duration_ns) {
+        request_bytes.Record(num_bytes);
+        request_duration_ns.Record(duration_ns);
+        bytes_served.fetch_add(num_bytes, std::memory_order_relaxed);
+    }
+
+    void RecordGetrandom(uint64_t num_bytes, uint64_t duration_ns, bool ok) {
+        getrandom_calls.fetch_add(1, std::memory_order_relaxed);
+        getrandom_bytes.fetch_add(num_bytes, std::memory_order_relaxed);
+        getrandom_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+        if (!ok) {
+            getrandom_errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Render(MetricsText& text) const {
+        // Sizes 1 B .. 16 MiB, durations 1 us .. 1 s
+        text.Histogram("randombytes_request_size_bytes", "Requested number of random bytes.",
+                       request_bytes, 1, 24, 1.0);
+        text.Histogram("randombytes_request_duration_seconds",
+                       "Time from reading a request to sending its response.",
+                       request_duration_ns, 10, 30, 1e-9);
+        text.Counter("randombytes_served_bytes_total", "Random bytes sent to clients.",
+                     bytes_served.load(std::memory_order_relaxed));
+        text.Counter("randombytes_getrandom_calls_total", "getrandom() calls.",
+                     getrandom_calls.load(std::memory_order_relaxed));
+        text.Counter("randombytes_getrandom_bytes_total", "Bytes requested from getrandom().",
+                     getrandom_bytes.load(std::memory_order_relaxed));
+        text.Counter("randombytes_getrandom_seconds_total", "Time spent in getrandom().",
+                     getrandom_ns.load(std::memory_order_relaxed) * 1e-9);
+        text.Counter("randombytes_getrandom_errors_total", "Failed or short getrandom() calls.",
+                     getrandom_errors.load(std::memory_order_relaxed));
+    }
+};
+
+// Listening socket for the metrics endpoint. An address containing '/' is a
+// Unix socket path, "HOST:PORT" is TCP, and a bare port binds 127.0.0.1.
+// Returns -1 after printing an error.
+inline int create_metrics_listener(const std::string& address) {
+    int fd;
+    if (address.find('/') != std::string::npos) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "Metrics socket path too long: %s\n", address.c_str());
+            return -1;
+        }
+        strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(address.c_str());
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            fprintf(stderr, "Failed to bind metrics socket %s: %s\n", address.c_str(), strerror(errno));
+            if (fd >= 0) {
+                close(fd);
+            }
+            return -1;
+        }
+    } else {
+        std::string host = "127.0.0.1";
+        std::string port = address;
+        size_t colon = address.rfind(':');
+        if (colon != std::string::npos) {
+            host = address.substr(0, colon);
+            port = address.substr(colon + 1);
+        }
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(atoi(port.c_str())));
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+            fprintf(stderr, "Invalid metrics address: %s\n", address.c_str());
+            return -1;
+        }
+
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int reuse = 1;
+        if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+            bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            fprintf(stderr, "Failed to bind metrics address %s: %s\n", address.c_str(), strerror(errno));
+            if (fd >= 0) {
+                close(fd);
+            }
+            return -1;
+        }
+    }
+
+    if (listen(fd, 16) < 0) {
+        fprintf(stderr, "Failed to listen on metrics socket: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Answer one scrape on an accepted connection and close it. The HTTP request
+// is read (up to the blank line, with a short timeout so a plain `nc` works
+// too) but not parsed: every path returns the metrics.
+inline void serve_metrics_client(int client_fd, const std::string& body) {
+    struct timeval timeout = {0, 100000};
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.size() < 8192 && request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = recv(client_fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        request.append(buffer, n);
+    }
+
+    char header[160];
+    snprintf(header, sizeof(header),
+             "HTTP/1.0 200 OK\r\n"
+             "Content-Type: text/plain; version=0.0.4\r\n"
+             "Content-Length: %zu\r\n"
+             "Connection: close\r\n\r\n",
+             body.size());
+    std::string response = header + body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+    close(client_fd);
+}
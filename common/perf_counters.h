@@ -0,0 +1,271 @@
+/*
+ * Hardware and software performance counters via perf_event_open
+ * Used by the clients and servers to report per-request cycles,
+ * instructions, context switches, cache misses, page faults and task-clock
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+enum PerfCounterId {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_CONTEXT_SWITCHES,
+    PERF_PAGE_FAULTS,
+    PERF_TASK_CLOCK,
+    PERF_NUM_COUNTERS,
+};
+
+struct PerfCounterSpec {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+const PerfCounterSpec PERF_COUNTER_SPECS[PERF_NUM_COUNTERS] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"task-clock-ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+};
+
+// Counter values, scaled for multiplexing. Counters that could not be
+// opened are marked invalid.
+struct PerfSample {
+    uint64_t values[PERF_NUM_COUNTERS] = {};
+    bool valid[PERF_NUM_COUNTERS] = {};
+};
+
+// A set of counters covering either the calling thread (one perf group, so
+// all counters are scheduled together) or the whole process (inherited by
+// threads created after Open(), each counter read separately because group
+// reads are not supported for inherited counters on all kernels).
+//
+// Opening degrades step by step: if perf_event_paranoid forbids kernel-mode
+// counting it retries user-space only, hardware counters missing in VMs are
+// skipped, and if nothing can be opened the set stays disabled and Read()
+// returns a sample with no valid counters. Context switches only happen in
+// the kernel, so in user-space only mode that counter still counts kernel
+// mode, or is left out if that is refused, rather than reading 0.
+class PerfCounters {
+public:
+    enum Scope { kThread, kProcess };
+
+    PerfCounters() {
+        for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+            fds_[i] = -1;
+        }
+    }
+
+    ~PerfCounters() {
+        Close();
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Open the counters disabled; returns false if none could be opened
+    bool Open(Scope scope) {
+        Close();
+        scope_ = scope;
+
+        if (!OpenAll(false) && paranoid_error_) {
+            Close();
+            OpenAll(true);
+            user_only_ = true;
+        }
+        if (num_open_ == 0) {
+            status_ = "unavailable (" + std::string(strerror(first_errno_)) +
+                      "; check /proc/sys/kernel/perf_event_paranoid)";
+            return false;
+        }
+
+        status_ = scope_ == kThread ? "thread" : "process";
+        if (user_only_) {
+            status_ += ", user-space only";
+        }
+        for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+            if (fds_[i] < 0) {
+                status_ += std::string(", no ") + PERF_COUNTER_SPECS[i].name;
+            }
+        }
+        return true;
+    }
+
+    bool enabled() const { return num_open_ > 0; }
+
+    // Human readable description of what is being counted
+    const std::string& status() const { return status_; }
+
+    void Start() {
+        Control(PERF_EVENT_IOC_RESET);
+        Control(PERF_EVENT_IOC_ENABLE);
+    }
+
+    void Stop() {
+        Control(PERF_EVENT_IOC_DISABLE);
+    }
+
+    PerfSample Read() const {
+        PerfSample sample;
+        if (num_open_ == 0) {
+            return sample;
+        }
+
+        if (scope_ == kThread) {
+            // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, values[nr]
+            uint64_t buffer[3 + PERF_NUM_COUNTERS];
+            if (read(leader_fd_, buffer, sizeof(buffer)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+                return sample;
+            }
+            double scale = Scale(buffer[1], buffer[2]);
+            for (uint64_t n = 0; n < buffer[0] && n < static_cast<uint64_t>(num_open_); ++n) {
+                int id = order_[n];
+                sample.values[id] = static_cast<uint64_t>(buffer[3 + n] * scale);
+                sample.valid[id] = true;
+            }
+            return sample;
+        }
+
+        for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+            // value, time_enabled, time_running
+            uint64_t buffer[3];
+            if (fds_[i] < 0 || read(fds_[i], buffer, sizeof(buffer)) != sizeof(buffer)) {
+                continue;
+            }
+            sample.values[i] = static_cast<uint64_t>(buffer[0] * Scale(buffer[1], buffer[2]));
+            sample.valid[i] = true;
+        }
+        return sample;
+    }
+
+private:
+    Scope scope_ = kThread;
+    int fds_[PERF_NUM_COUNTERS];
+    int order_[PERF_NUM_COUNTERS] = {};  // group read position -> counter id
+    int num_open_ = 0;
+    int leader_fd_ = -1;
+    bool user_only_ = false;
+    bool paranoid_error_ = false;
+    int first_errno_ = 0;
+    std::string status_ = "disabled";
+
+    static double Scale(uint64_t enabled, uint64_t running) {
+        return running > 0 && running < enabled ? static_cast<double>(enabled) / running : 1.0;
+    }
+
+    bool OpenAll(bool user_only) {
+        paranoid_error_ = false;
+        for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_COUNTER_SPECS[i].type;
+            attr.config = PERF_COUNTER_SPECS[i].config;
+            // Context switches are kernel-mode events; excluding the kernel
+            // would always count 0
+            attr.exclude_kernel = user_only && i != PERF_CONTEXT_SWITCHES ? 1 : 0;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            int group_fd = -1;
+            if (scope_ == kThread) {
+                attr.read_format |= PERF_FORMAT_GROUP;
+                group_fd = leader_fd_;
+            } else {
+                attr.inherit = 1;
+            }
+            // Only the leader (or each counter in process scope) starts
+            // disabled, group members follow their leader
+            attr.disabled = group_fd < 0 ? 1 : 0;
+
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+            if (fd < 0) {
+                // Left out rather than counted as 0 with exclude_kernel
+                if (user_only && i == PERF_CONTEXT_SWITCHES) {
+                    continue;
+                }
+                if (first_errno_ == 0) {
+                    first_errno_ = errno;
+                }
+                if (errno == EACCES || errno == EPERM) {
+                    paranoid_error_ = true;
+                }
+                continue;
+            }
+
+            fds_[i] = fd;
+            order_[num_open_++] = i;
+            if (scope_ == kThread && leader_fd_ < 0) {
+                leader_fd_ = fd;
+            }
+        }
+        return num_open_ == PERF_NUM_COUNTERS;
+    }
+
+    void Control(unsigned long request) {
+        if (num_open_ == 0) {
+            return;
+        }
+        if (scope_ == kThread) {
+            ioctl(leader_fd_, request, PERF_IOC_FLAG_GROUP);
+            return;
+        }
+        for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+            if (fds_[i] >= 0) {
+                ioctl(fds_[i], request, 0);
+            }
+        }
+    }
+
+    void Close() {
+        for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+            if (fds_[i] >= 0) {
+                close(fds_[i]);
+                fds_[i] = -1;
+            }
+        }
+        num_open_ = 0;
+        leader_fd_ = -1;
+        user_only_ = false;
+    }
+};
+
+// Print counters divided by the number of requests, e.g.
+//   client perf (thread): per request cycles 12345 instructions 23456 (IPC 1.90) ...
+inline void print_perf_report(FILE* out, const char* who, const PerfCounters& counters,
+                              const PerfSample& sample, uint64_t requests) {
+    if (!counters.enabled()) {
+        fprintf(out, "%s perf: %s\n", who, counters.status().c_str());
+        return;
+    }
+    if (requests == 0) {
+        requests = 1;
+    }
+
+    fprintf(out, "%s perf (%s): per request", who, counters.status().c_str());
+    for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+        if (!sample.valid[i]) {
+            continue;
+        }
+        fprintf(out, " %s %.1f", PERF_COUNTER_SPECS[i].name,
+                static_cast<double>(sample.values[i]) / requests);
+        if (i == PERF_INSTRUCTIONS && sample.valid[PERF_CYCLES] && sample.values[PERF_CYCLES] > 0) {
+            fprintf(out, " (IPC %.2f)",
+                    static_cast<double>(sample.values[PERF_INSTRUCTIONS]) / sample.values[PERF_CYCLES]);
+        }
+    }
+    fprintf(out, " over %llu requests\n", static_cast<unsigned long long>(requests));
+}
@@ -0,0 +1,30 @@
+/*
+ * USDT tracepoints on the request path
+ * Each probe is a single nop plus an ELF note, so it costs nothing until
+ * bpftrace or perf attaches to it. Without <sys/sdt.h> (systemtap-sdt-dev)
+ * the probes compile to nothing.
+ *
+ * Probes, all in the "randombytes" provider:
+ *   request_start(fd, num_bytes)       server read a request / client is about to send one
+ *   entropy_generated(fd, num_bytes)   server filled the response buffer
+ *   response_sent(fd, num_bytes)       server finished sending the response
+ *   response_received(fd, num_bytes)  client received the full response
+ * gRPC passes 0 as fd.
+ */
+
+#pragma once
+
+#if defined(__has_include) && !defined(RANDOMBYTES_NO_PROBES)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define RANDOMBYTES_PROBES_ENABLED 1
+#define RANDOMBYTES_PROBE(name, fd, num_bytes) STAP_PROBE2(randombytes, name, fd, num_bytes)
+#endif
+#endif
+
+// Arguments are still evaluated as discarded expressions, so parameters
+// used only in probes do not trigger -Wunused-parameter
+#ifndef RANDOMBYTES_PROBE
+#define RANDOMBYTES_PROBES_ENABLED 0
+#define RANDOMBYTES_PROBE(name, fd, num_bytes) do { (void)(fd); (void)(num_bytes); } while (0)
+#endif
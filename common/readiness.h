@@ -0,0 +1,53 @@
+/*
+ * Server readiness notification shared by the benchmark servers
+ * Lets drivers wait for a server to accept connections instead of sleeping
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Report that the server is accepting connections. Writes "READY=1\n" to
+// ready_fd and closes it if ready_fd >= 0, and sends READY=1 to
+// $NOTIFY_SOCKET when one is set (the sd_notify protocol used by systemd).
+inline void notify_ready(int ready_fd) {
+    static const char message[] = "READY=1\n";
+
+    if (ready_fd >= 0) {
+        ssize_t written = write(ready_fd, message, sizeof(message) - 1);
+        (void)written; // Nothing useful to do if the driver went away
+        close(ready_fd);
+    }
+
+    const char* notify_socket = getenv("NOTIFY_SOCKET");
+    if (notify_socket == NULL || notify_socket[0] == '\0') {
+        return;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    size_t path_len = strlen(notify_socket);
+    if (path_len >= sizeof(addr.sun_path)) {
+        return;
+    }
+    memcpy(addr.sun_path, notify_socket, path_len);
+    // A leading '@' denotes an abstract socket address
+    if (addr.sun_path[0] == '@') {
+        addr.sun_path[0] = '\0';
+    }
+
+    int sock_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock_fd < 0) {
+        return;
+    }
+    socklen_t addr_len = offsetof(struct sockaddr_un, sun_path) + path_len;
+    sendto(sock_fd, message, sizeof(message) - 2, 0, (struct sockaddr*)&addr, addr_len);
+    close(sock_fd);
+}
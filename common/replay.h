@@ -0,0 +1,247 @@
+/*
+ * Trace-driven workload replay
+ * Reads a timestamped request trace and reissues it with the original
+ * spacing from several client threads. Waits are slept until shortly before
+ * the scheduled time and spun for the rest, and every latency is measured
+ * from the scheduled time, so a server that falls behind shows up as
+ * queueing rather than being hidden by a slower request stream.
+ *
+ * Open-loop runs at a fixed rate use the same machinery with a generated
+ * schedule.
+ *
+ * Trace format, CSV with an optional header and '#' comments:
+ *   offset_ns,bytes,client             arrival offset, request size, client id
+ *   start_ns,latency_ns,bytes,status   tools/trace_reader output, replayed as client 0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+
+#include "clock.h"
+#include "workload.h"
+
+struct ReplayRequest {
+    uint64_t offset_ns;   // from the start of the replay
+    uint32_t bytes;
+    uint32_t client;
+};
+
+struct ReplayOutcome {
+    uint64_t scheduled_ns;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t bytes;
+    bool ok;
+};
+
+// Load a trace sorted by offset; prints the reason and returns false on error
+inline bool load_replay_trace(const std::string& path, std::vector<ReplayRequest>* requests) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "Failed to open replay trace %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    bool trace_reader_columns = false;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (!isdigit(static_cast<unsigned char>(line[0]))) {
+            trace_reader_columns = line.compare(0, 19, "start_ns,latency_ns") == 0;
+            continue;
+        }
+        std::vector<uint64_t> fields;
+        std::istringstream cells(line);
+        std::string cell;
+        while (std::getline(cells, cell, ',')) {
+            fields.push_back(strtoull(cell.c_str(), NULL, 10));
+        }
+        uint64_t bytes, client = 0;
+        if (trace_reader_columns && fields.size() >= 3) {
+            bytes = fields[2];
+        } else if (!trace_reader_columns && fields.size() >= 2) {
+            bytes = fields[1];
+            client = fields.size() >= 3 ? fields[2] : 0;
+        } else {
+            fprintf(stderr, "%s:%d: expected offset_ns,bytes,client\n", path.c_str(), line_number);
+            return false;
+        }
+        if (bytes == 0) {
+            fprintf(stderr, "%s:%d: request size must be positive\n", path.c_str(), line_number);
+            return false;
+        }
+        // Larger sizes would set the socket protocol's flag bits
+        if (bytes > Workload::kMaxSize) {
+            fprintf(stderr, "%s:%d: request size must be at most %llu\n", path.c_str(), line_number,
+                    static_cast<unsigned long long>(Workload::kMaxSize));
+            return false;
+        }
+        requests->push_back({fields[0], static_cast<uint32_t>(bytes), static_cast<uint32_t>(client)});
+    }
+    std::stable_sort(requests->begin(), requests->end(),
+                     [](const ReplayRequest& a, const ReplayRequest& b) { return a.offset_ns < b.offset_ns; });
+    if (requests->empty()) {
+        fprintf(stderr, "Replay trace %s has no requests\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Open-loop schedule: one request per size at rate per second on average,
+// with exponential gaps (Poisson arrivals), round-robin over clients
+inline std::vector<ReplayRequest> make_rate_schedule(const std::vector<uint32_t>& sizes, double rate,
+                                                     uint32_t clients, uint64_t seed = 1) {
+    std::mt19937_64 rng(seed);
+    std::exponential_distribution<double> gap_ns(rate / 1e9);
+    std::vector<ReplayRequest> requests;
+    requests.reserve(sizes.size());
+    double offset = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        requests.push_back({static_cast<uint64_t>(offset), sizes[i], static_cast<uint32_t>(i % clients)});
+        offset += gap_ns(rng);
+    }
+    return requests;
+}
+
+// Sleep until shortly before deadline_ns (CLOCK_MONOTONIC), then spin. The
+// spin margin covers timer slack and wake-up latency.
+inline void pace_until(uint64_t deadline_ns) {
+    const uint64_t kSpinNs = 50000;
+    uint64_t now = clock_ns(CLOCK_MONOTONIC);
+    if (deadline_ns > now + kSpinNs) {
+        uint64_t wake = deadline_ns - kSpinNs;
+        struct timespec ts = {static_cast<time_t>(wake / 1000000000ull), static_cast<long>(wake % 1000000000ull)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+    }
+    while (clock_ns(CLOCK_MONOTONIC) < deadline_ns) {
+    }
+}
+
+// Number of threads the trace asks for: one per distinct client id
+inline int replay_clients(const std::vector<ReplayRequest>& requests) {
+    std::map<uint32_t, bool> clients;
+    for (const ReplayRequest& request : requests) {
+        clients[request.client] = true;
+    }
+    return static_cast<int>(clients.size());
+}
+
+// Replay requests from threads threads; client ids map onto threads in order
+// of first appearance, modulo the thread count. make_caller runs on each
+// thread before the start and returns that thread's bool(uint32_t bytes)
+// call, so every thread gets its own connection.
+template <typename MakeCaller>
+std::vector<ReplayOutcome> run_replay(const std::vector<ReplayRequest>& requests, int threads,
+                                      MakeCaller make_caller) {
+    std::map<uint32_t, int> thread_of;
+    std::vector<std::vector<const ReplayRequest*>> work(threads);
+    for (const ReplayRequest& request : requests) {
+        auto it = thread_of.find(request.client);
+        if (it == thread_of.end()) {
+            int next = static_cast<int>(thread_of.size()) % threads;
+            it = thread_of.insert({request.client, next}).first;
+        }
+        work[it->second].push_back(&request);
+    }
+
+    std::vector<std::vector<ReplayOutcome>> outcomes(threads);
+    std::atomic<int> ready(0);
+    std::atomic<uint64_t> start_ns(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            auto call = make_caller();
+            outcomes[t].reserve(work[t].size());
+            ready.fetch_add(1);
+            uint64_t start;
+            while ((start = start_ns.load(std::memory_order_acquire)) == 0) {
+                std::this_thread::yield();
+            }
+            for (const ReplayRequest* request : work[t]) {
+                uint64_t scheduled = start + request->offset_ns;
+                pace_until(scheduled);
+                uint64_t call_start = clock_ns(CLOCK_MONOTONIC);
+                bool ok = call(request->bytes);
+                outcomes[t].push_back({scheduled, call_start, clock_ns(CLOCK_MONOTONIC), request->bytes, ok});
+            }
+        });
+    }
+
+    // Start together once every thread has its connection, with a little
+    // headroom for the threads to reach their first wait
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+    start_ns.store(clock_ns(CLOCK_MONOTONIC) + 10000000, std::memory_order_release);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<ReplayOutcome> all;
+    for (const auto& thread_outcomes : outcomes) {
+        all.insert(all.end(), thread_outcomes.begin(), thread_outcomes.end());
+    }
+    return all;
+}
+
+// "name p50 .. p90 .. p99 .. p99.9 .. max .." of values, sorted in place
+inline void print_replay_percentiles(FILE* out, const char* name, std::vector<uint64_t>& values) {
+    if (values.empty()) {
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    fprintf(out, "replay %s p50 %llu p90 %llu p99 %llu p99.9 %llu max %llu\n", name,
+            static_cast<unsigned long long>(values[n / 2]),
+            static_cast<unsigned long long>(values[n * 90 / 100]),
+            static_cast<unsigned long long>(values[n * 99 / 100]),
+            static_cast<unsigned long long>(values[n * 999 / 1000]),
+            static_cast<unsigned long long>(values[n - 1]));
+}
+
+// Summary lines for a finished replay. Returns the latencies from the
+// scheduled time for the result record.
+inline std::vector<uint64_t> print_replay_report(FILE* out, const std::vector<ReplayOutcome>& outcomes,
+                                                 int threads) {
+    std::vector<uint64_t> from_schedule, service, start_lag;
+    uint64_t failed = 0;
+    uint64_t first = UINT64_MAX, last = 0;
+    for (const ReplayOutcome& outcome : outcomes) {
+        first = std::min(first, outcome.scheduled_ns);
+        last = std::max(last, outcome.end_ns);
+        if (!outcome.ok) {
+            failed++;
+            continue;
+        }
+        from_schedule.push_back(outcome.end_ns - outcome.scheduled_ns);
+        service.push_back(outcome.end_ns - outcome.start_ns);
+        start_lag.push_back(outcome.start_ns > outcome.scheduled_ns ? outcome.start_ns - outcome.scheduled_ns : 0);
+    }
+    fprintf(out, "replay requests %zu threads %d failed %llu seconds %.3f\n", outcomes.size(), threads,
+            static_cast<unsigned long long>(failed), outcomes.empty() ? 0.0 : (last - first) / 1e9);
+    std::vector<uint64_t> result = from_schedule;
+    print_replay_percentiles(out, "latency_ns", from_schedule);
+    print_replay_percentiles(out, "service_ns", service);
+    print_replay_percentiles(out, "start_lag_ns", start_lag);
+    return result;
+}
@@ -0,0 +1,221 @@
+/*
+ * Structured per-run results
+ * Clients append one record per run as a JSON line or a CSV row, with
+ * latency percentiles, throughput, CPU and RSS, and enough metadata about
+ * the host and build to compare runs from different machines and days
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+// Set by the build (common/build_info.cmake)
+#ifndef BENCH_GIT_HASH
+#define BENCH_GIT_HASH "unknown"
+#endif
+#ifndef BENCH_BUILD_FLAGS
+#define BENCH_BUILD_FLAGS "unknown"
+#endif
+
+// Ordered key/value fields. Numbers are written bare, strings quoted in JSON.
+class ResultRecord {
+public:
+    void Add(const std::string& key, const std::string& value) {
+        fields_.push_back({key, {value, true}});
+    }
+
+    void Add(const std::string& key, const char* value) {
+        Add(key, std::string(value));
+    }
+
+    void Add(const std::string& key, uint64_t value) {
+        fields_.push_back({key, {std::to_string(value), false}});
+    }
+
+    void Add(const std::string& key, double value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.6g", value);
+        fields_.push_back({key, {text, false}});
+    }
+
+    std::string ToJson() const {
+        std::string json = "{";
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            json += (i > 0 ? ", \"" : "\"") + Escape(fields_[i].first) + "\": ";
+            const Value& value = fields_[i].second;
+            json += value.second ? "\"" + Escape(value.first) + "\"" : value.first;
+        }
+        return json + "}";
+    }
+
+    std::string CsvHeader() const {
+        std::string header;
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            header += (i > 0 ? "," : "") + Quote(fields_[i].first);
+        }
+        return header;
+    }
+
+    std::string CsvRow() const {
+        std::string row;
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            const Value& value = fields_[i].second;
+            row += (i > 0 ? "," : "") + (value.second ? Quote(value.first) : value.first);
+        }
+        return row;
+    }
+
+    // Append to path: CSV when it ends in .csv, otherwise one JSON object
+    // per line. A CSV header is written whenever the file's last header
+    // differs from this record's fields (new file, other client, options
+    // that add fields), so every row lines up with the header above it.
+    bool AppendTo(const std::string& path) const {
+        bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        std::string header = csv ? CsvHeader() : "";
+        bool write_header = csv && LastCsvHeader(path) != header;
+        FILE* file = fopen(path.c_str(), "a");
+        if (file == NULL) {
+            perror(path.c_str());
+            return false;
+        }
+        if (write_header) {
+            fprintf(file, "%s\n", header.c_str());
+        }
+        fprintf(file, "%s\n", csv ? CsvRow().c_str() : ToJson().c_str());
+        return fclose(file) == 0;
+    }
+
+private:
+    typedef std::pair<std::string, bool> Value;  // text, is string
+    std::vector<std::pair<std::string, Value>> fields_;
+
+    static std::string Escape(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    // Last line of an existing CSV file that starts like this record's
+    // header (a quoted first key), or "" if there is none
+    std::string LastCsvHeader(const std::string& path) const {
+        std::ifstream in(path);
+        std::string line, last;
+        std::string prefix = fields_.empty() ? "" : Quote(fields_[0].first) + ",";
+        while (std::getline(in, line)) {
+            if (!prefix.empty() && line.compare(0, prefix.size(), prefix) == 0) {
+                last = line;
+            }
+        }
+        return last;
+    }
+
+    static std::string Quote(const std::string& text) {
+        std::string quoted = "\"";
+        for (char c : text) {
+            quoted += c;
+            if (c == '"') {
+                quoted += '"';
+            }
+        }
+        return quoted + "\"";
+    }
+};
+
+// First line of a file, or "unknown"
+inline std::string read_first_line(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return "unknown";
+    }
+    char line[256];
+    std::string text = fgets(line, sizeof(line), file) != NULL ? line : "unknown";
+    fclose(file);
+    text.erase(text.find_last_not_of(" \n") + 1);
+    return text;
+}
+
+inline std::string read_cpu_model() {
+    FILE* file = fopen("/proc/cpuinfo", "r");
+    if (file == NULL) {
+        return "unknown";
+    }
+    char line[512];
+    std::string model = "unknown";
+    while (fgets(line, sizeof(line), file) != NULL) {
+        std::string text = line;
+        if (text.compare(0, 10, "model name") == 0 && text.find(':') != std::string::npos) {
+            model = text.substr(text.find(':') + 2);
+            model.erase(model.find_last_not_of(" \n") + 1);
+            break;
+        }
+    }
+    fclose(file);
+    return model;
+}
+
+// Host, kernel, CPU and build description
+inline void add_run_metadata(ResultRecord& record) {
+    struct utsname uts;
+    bool have_uts = uname(&uts) == 0;
+    char hostname[256] = "unknown";
+    gethostname(hostname, sizeof(hostname) - 1);
+
+    record.Add("timestamp", static_cast<uint64_t>(time(NULL)));
+    record.Add("hostname", hostname);
+    record.Add("kernel", have_uts ? uts.release : "unknown");
+    record.Add("arch", have_uts ? uts.machine : "unknown");
+    record.Add("cpu_model", read_cpu_model());
+    record.Add("cpus", static_cast<uint64_t>(sysconf(_SC_NPROCESSORS_ONLN)));
+    record.Add("governor", read_first_line("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor"));
+    record.Add("smt", read_first_line("/sys/devices/system/cpu/smt/control"));
+    record.Add("git_hash", BENCH_GIT_HASH);
+    record.Add("build_flags", BENCH_BUILD_FLAGS);
+    record.Add("compiler", __VERSION__);
+}
+
+// min, mean, p50, p90, p99, p99.9 and max of per-call latencies in ns
+inline void add_latency_percentiles(ResultRecord& record, std::vector<uint64_t> latencies_ns) {
+    if (latencies_ns.empty()) {
+        return;
+    }
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    double sum = 0;
+    for (uint64_t latency : latencies_ns) {
+        sum += latency;
+    }
+    size_t n = latencies_ns.size();
+    record.Add("latency_min_ns", latencies_ns.front());
+    record.Add("latency_mean_ns", sum / n);
+    record.Add("latency_p50_ns", latencies_ns[n / 2]);
+    record.Add("latency_p90_ns", latencies_ns[n * 90 / 100]);
+    record.Add("latency_p99_ns", latencies_ns[n * 99 / 100]);
+    record.Add("latency_p999_ns", latencies_ns[n * 999 / 1000]);
+    record.Add("latency_max_ns", latencies_ns.back());
+}
+
+// Peak resident set size of this process so far
+inline uint64_t max_rss_kb() {
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? static_cast<uint64_t>(ru.ru_maxrss) : 0;
+}
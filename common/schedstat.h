@@ -0,0 +1,77 @@
+/*
+ * Scheduler delay accounting from /proc/<pid>/task/<tid>/schedstat
+ * Separates time spent running from time spent runnable but waiting for a
+ * CPU, so IPC latency on a busy host can be attributed to scheduling
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <dirent.h>
+
+// Totals over the threads of a process. Plain data so the socket server can
+// send it as a control reply. Threads that exit between two samples drop
+// out of the later one, so sample around a phase in which the set of
+// threads is stable.
+struct SchedStat {
+    uint64_t run_ns = 0;      // time on a CPU
+    uint64_t wait_ns = 0;     // time runnable on a run queue
+    uint64_t timeslices = 0;  // times scheduled in
+};
+
+// Sum schedstat over all threads of the current process. Returns false when
+// schedstat is unavailable (kernels without CONFIG_SCHED_INFO).
+inline bool read_sched_stat(SchedStat* total) {
+    *total = SchedStat();
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == NULL) {
+        return false;
+    }
+
+    bool found = false;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char path[sizeof("/proc/self/task//schedstat") + sizeof(entry->d_name)];
+        snprintf(path, sizeof(path), "/proc/self/task/%s/schedstat", entry->d_name);
+        FILE* file = fopen(path, "r");
+        if (file == NULL) {
+            continue;  // thread exited
+        }
+        unsigned long long run_ns, wait_ns, timeslices;
+        if (fscanf(file, "%llu %llu %llu", &run_ns, &wait_ns, &timeslices) == 3) {
+            total->run_ns += run_ns;
+            total->wait_ns += wait_ns;
+            total->timeslices += timeslices;
+            found = true;
+        }
+        fclose(file);
+    }
+    closedir(dir);
+    return found;
+}
+
+inline SchedStat operator-(const SchedStat& after, const SchedStat& before) {
+    SchedStat delta;
+    delta.run_ns = after.run_ns - before.run_ns;
+    delta.wait_ns = after.wait_ns - before.wait_ns;
+    delta.timeslices = after.timeslices - before.timeslices;
+    return delta;
+}
+
+// Print one line per side, e.g.
+//   client sched run_us_per_request 5.1 runqueue_us_per_request 0.8 timeslices_per_request 1.2 runqueue_share 13.6%
+inline void print_sched_delay(FILE* out, const char* who, const SchedStat& delta, uint64_t requests) {
+    if (requests == 0) {
+        requests = 1;
+    }
+    uint64_t total_ns = delta.run_ns + delta.wait_ns;
+    fprintf(out, "%s sched run_us_per_request %.3f runqueue_us_per_request %.3f "
+                 "timeslices_per_request %.3f runqueue_share %.1f%%\n",
+            who, delta.run_ns / 1000.0 / requests, delta.wait_ns / 1000.0 / requests,
+            static_cast<double>(delta.timeslices) / requests,
+            total_ns > 0 ? 100.0 * delta.wait_ns / total_ns : 0.0);
+}
@@ -0,0 +1,84 @@
+/*
+ * Process startup timestamps for the cold-start benchmark
+ * Clients mark the phases of their first request and write them to a file
+ * descriptor handed over by the launcher (tools/coldstart)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+
+inline uint64_t startup_monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// Taken by the executable's first constructor. In a dynamically linked
+// client every shared library initialiser (protobuf descriptors, absl, gRPC
+// globals) has run by then, so the gap from exec to this point is dynamic
+// loading plus library static init. In a fully static build all
+// initialisers share one .init_array and prioritised ones run first, so this
+// mark comes before library static init, which then falls into pre_main.
+// One definition for the whole program; each including TU registers a
+// constructor and the first one to run sets it.
+inline uint64_t startup_constructor_ns = 0;
+
+__attribute__((constructor(101))) static void startup_record_constructor() {
+    if (startup_constructor_ns == 0) {
+        startup_constructor_ns = startup_monotonic_ns();
+    }
+}
+
+// Collects named CLOCK_MONOTONIC timestamps and writes them as a single
+// "name=ns ..." line. Disabled when constructed with a negative fd.
+class StartupReport {
+public:
+    explicit StartupReport(int fd) : fd_(fd) {
+        if (fd_ >= 0) {
+            Mark("constructor", startup_constructor_ns);
+        }
+    }
+
+    bool enabled() const { return fd_ >= 0; }
+
+    void Mark(const char* phase) {
+        if (fd_ >= 0) {
+            Mark(phase, startup_monotonic_ns());
+        }
+    }
+
+    void Mark(const char* phase, uint64_t ns) {
+        if (fd_ >= 0) {
+            marks_.emplace_back(phase, ns);
+        }
+    }
+
+    // Write the collected marks and close the fd; later marks are ignored
+    void Finish() {
+        if (fd_ < 0) {
+            return;
+        }
+        std::string line;
+        for (const auto& mark : marks_) {
+            char field[96];
+            snprintf(field, sizeof(field), "%s%s=%llu", line.empty() ? "" : " ",
+                     mark.first.c_str(), static_cast<unsigned long long>(mark.second));
+            line += field;
+        }
+        line += "\n";
+        ssize_t written = write(fd_, line.data(), line.size());
+        (void)written;
+        close(fd_);
+        fd_ = -1;
+    }
+
+private:
+    int fd_;
+    std::vector<std::pair<std::string, uint64_t>> marks_;
+};
@@ -0,0 +1,62 @@
+/*
+ * Steady-state detection for in-process warm-up
+ * Clients warm up in batches and stop once the mean call time of the last
+ * few batches varies little (coefficient of variation below a limit), so
+ * measured epochs start with warm caches, connections and frequency.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <deque>
+
+class SteadyStateDetector {
+public:
+    static const int kWindow = 5;        // batches compared
+    static const int kMaxBatches = 100;  // give up after this many
+
+    explicit SteadyStateDetector(double max_cv) : max_cv_(max_cv) {}
+
+    // Add one batch's mean call time; returns true once steady
+    bool Add(double batch_mean) {
+        batches_++;
+        window_.push_back(batch_mean);
+        if (window_.size() > static_cast<size_t>(kWindow)) {
+            window_.pop_front();
+        }
+        return steady();
+    }
+
+    bool steady() const {
+        return window_.size() == static_cast<size_t>(kWindow) && cv() <= max_cv_;
+    }
+
+    // Stop warming up: steady, or out of batches
+    bool done() const {
+        return steady() || batches_ >= kMaxBatches;
+    }
+
+    int batches() const { return batches_; }
+
+    // Coefficient of variation (stddev / mean) of the current window
+    double cv() const {
+        if (window_.empty()) {
+            return 0;
+        }
+        double sum = 0;
+        for (double value : window_) {
+            sum += value;
+        }
+        double mean = sum / window_.size();
+        double squares = 0;
+        for (double value : window_) {
+            squares += (value - mean) * (value - mean);
+        }
+        return mean > 0 ? sqrt(squares / window_.size()) / mean : 0;
+    }
+
+private:
+    double max_cv_;
+    int batches_ = 0;
+    std::deque<double> window_;
+};
@@ -0,0 +1,126 @@
+/*
+ * Binary per-call latency trace
+ * The client writes one fixed-size record per call into a file that is
+ * sized, mapped and pre-faulted before the timed loop, so recording a call
+ * is a couple of stores with no syscalls. tools/trace_reader converts the
+ * file to CSV or a histogram.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+const char TRACE_FILE_MAGIC[8] = {'R', 'B', 'T', 'R', 'A', 'C', 'E', '1'};
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t record_size;     // sizeof(TraceRecord)
+    uint32_t reserved;
+    uint64_t num_records;     // records written, set when the file is closed. A
+                              // client that dies leaves 0 and the untrimmed,
+                              // zero-filled file; readers then count records
+                              // up to the last non-zero one.
+    uint64_t start_unix_ns;   // wall clock at Open(), to line traces up with other logs
+    char transport[16];       // "socket", "grpc", ...
+};
+
+struct TraceRecord {
+    uint64_t start_ns;        // call start, relative to the first call
+    uint64_t latency_ns;
+    uint32_t bytes;           // bytes requested
+    uint32_t status;          // 0 = ok, 1 = failed
+};
+
+class TraceWriter {
+public:
+    ~TraceWriter() {
+        Close();
+    }
+
+    // Create path with room for capacity records, map it and touch every
+    // page so the timed loop takes no page faults
+    bool Open(const std::string& path, uint64_t capacity, const char* transport) {
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            fprintf(stderr, "Failed to create trace file %s: %s\n", path.c_str(), strerror(errno));
+            return false;
+        }
+        size_ = sizeof(TraceFileHeader) + capacity * sizeof(TraceRecord);
+        if (ftruncate(fd_, size_) < 0) {
+            fprintf(stderr, "Failed to size trace file %s: %s\n", path.c_str(), strerror(errno));
+            Close();
+            return false;
+        }
+        void* map = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "Failed to map trace file %s: %s\n", path.c_str(), strerror(errno));
+            map_ = NULL;
+            Close();
+            return false;
+        }
+        map_ = static_cast<uint8_t*>(map);
+        memset(map_, 0, size_);
+
+        TraceFileHeader* header = Header();
+        memcpy(header->magic, TRACE_FILE_MAGIC, sizeof(header->magic));
+        header->record_size = sizeof(TraceRecord);
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        header->start_unix_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+        strncpy(header->transport, transport, sizeof(header->transport) - 1);
+
+        records_ = reinterpret_cast<TraceRecord*>(map_ + sizeof(TraceFileHeader));
+        capacity_ = capacity;
+        count_ = 0;
+        return true;
+    }
+
+    bool enabled() const { return map_ != NULL; }
+
+    // Calls beyond the capacity are dropped
+    void Append(uint64_t start_ns, uint64_t latency_ns, uint32_t bytes, bool ok) {
+        if (count_ < capacity_) {
+            TraceRecord& record = records_[count_++];
+            record.start_ns = start_ns;
+            record.latency_ns = latency_ns;
+            record.bytes = bytes;
+            record.status = ok ? 0 : 1;
+        }
+    }
+
+    // Record the count, trim unused space and unmap
+    void Close() {
+        if (map_ != NULL) {
+            Header()->num_records = count_;
+            munmap(map_, size_);
+            map_ = NULL;
+            if (ftruncate(fd_, sizeof(TraceFileHeader) + count_ * sizeof(TraceRecord)) < 0) {
+                fprintf(stderr, "Failed to trim trace file: %s\n", strerror(errno));
+            }
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+private:
+    int fd_ = -1;
+    uint8_t* map_ = NULL;
+    size_t size_ = 0;
+    TraceRecord* records_ = NULL;
+    uint64_t capacity_ = 0;
+    uint64_t count_ = 0;
+
+    TraceFileHeader* Header() {
+        return reinterpret_cast<TraceFileHeader*>(map_);
+    }
+};
@@ -0,0 +1,169 @@
+/*
+ * Mixed request-size workloads
+ * A workload spec describes a distribution of request sizes. Clients draw
+ * all sizes up front into an array, so the timed loop only indexes it, and
+ * report latency per power-of-two size class.
+ *
+ *   32:90,65536:9,4194304:1     discrete sizes with relative weights
+ *   loguniform:16:1048576       log-uniform between two sizes
+ *   zipf:1.2:16,64,1024,65536   Zipf over the listed sizes by rank, exponent 1.2
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+
+class Workload {
+public:
+    // Sizes must stay below 1 GiB, the socket protocol's flag bits
+    static const uint64_t kMaxSize = (1u << 30) - 1;
+
+    bool enabled() const { return kind_ != kNone; }
+    const std::string& spec() const { return spec_; }
+
+    // Returns false and sets error for a malformed spec
+    bool Parse(const std::string& spec, std::string* error) {
+        spec_ = spec;
+        sizes_.clear();
+        weights_.clear();
+        if (spec.compare(0, 11, "loguniform:") == 0) {
+            kind_ = kLogUniform;
+            char* rest;
+            min_ = strtoull(spec.c_str() + 11, &rest, 10);
+            max_ = *rest == ':' ? strtoull(rest + 1, &rest, 10) : 0;
+            if (*rest != '\0' || min_ == 0 || max_ < min_ || max_ > kMaxSize) {
+                *error = "expected loguniform:MIN:MAX with 0 < MIN <= MAX < 1 GiB";
+                return false;
+            }
+            return true;
+        }
+        if (spec.compare(0, 5, "zipf:") == 0) {
+            kind_ = kDiscrete;
+            char* rest;
+            double exponent = strtod(spec.c_str() + 5, &rest);
+            if (*rest != ':' || exponent <= 0 || !ParseSizes(rest + 1, false)) {
+                *error = "expected zipf:EXPONENT:SIZE,SIZE,... with a positive exponent";
+                return false;
+            }
+            weights_.clear();
+            for (size_t rank = 1; rank <= sizes_.size(); ++rank) {
+                weights_.push_back(1 / pow(rank, exponent));
+            }
+            return true;
+        }
+        kind_ = kDiscrete;
+        if (!ParseSizes(spec, true)) {
+            *error = "expected SIZE:WEIGHT,SIZE:WEIGHT,... with positive sizes below 1 GiB";
+            return false;
+        }
+        return true;
+    }
+
+    // n sizes drawn with a fixed seed, so runs of the same spec match
+    std::vector<uint32_t> Sample(size_t n, uint64_t seed = 1) const {
+        std::mt19937_64 rng(seed);
+        std::vector<uint32_t> sizes(n);
+        if (kind_ == kLogUniform) {
+            std::uniform_real_distribution<double> exponent(log(min_), log(max_ + 1.0));
+            for (uint32_t& size : sizes) {
+                size = std::min<uint64_t>(static_cast<uint64_t>(exp(exponent(rng))), max_);
+            }
+        } else {
+            std::discrete_distribution<size_t> pick(weights_.begin(), weights_.end());
+            for (uint32_t& size : sizes) {
+                size = sizes_[pick(rng)];
+            }
+        }
+        return sizes;
+    }
+
+private:
+    enum Kind { kNone, kDiscrete, kLogUniform };
+    Kind kind_ = kNone;
+    std::string spec_;
+    std::vector<uint32_t> sizes_;
+    std::vector<double> weights_;
+    uint64_t min_ = 0;
+    uint64_t max_ = 0;
+
+    // "size:weight,..." or, without weights, "size,..."
+    bool ParseSizes(const std::string& list, bool with_weights) {
+        std::istringstream items(list);
+        std::string item;
+        while (std::getline(items, item, ',')) {
+            char* rest;
+            uint64_t size = strtoull(item.c_str(), &rest, 10);
+            double weight = 1;
+            if (with_weights) {
+                if (*rest != ':') {
+                    return false;
+                }
+                weight = strtod(rest + 1, &rest);
+            }
+            if (*rest != '\0' || size == 0 || size > kMaxSize || weight <= 0) {
+                return false;
+            }
+            sizes_.push_back(static_cast<uint32_t>(size));
+            weights_.push_back(weight);
+        }
+        return !sizes_.empty();
+    }
+};
+
+// Latencies grouped by power-of-two request size class
+class SizeClassLatencies {
+public:
+    // Size each class for every epoch's calls, so Add never reallocates
+    // inside the timed loop
+    void Reserve(const std::vector<uint32_t>& sizes, int epochs) {
+        size_t counts[Log2Histogram::kBuckets] = {};
+        for (uint32_t size : sizes) {
+            counts[Log2Histogram::BucketFor(size)]++;
+        }
+        for (int b = 0; b < Log2Histogram::kBuckets; ++b) {
+            classes_[b].reserve(counts[b] * epochs);
+        }
+    }
+
+    void Add(uint32_t bytes, uint64_t latency_ns) {
+        classes_[Log2Histogram::BucketFor(bytes)].push_back(latency_ns);
+    }
+
+    // One line per class: "size_class 32-63 B calls N share X% p50_ns .. p99_ns .. mean_ns .."
+    void Print(FILE* out) {
+        size_t total = 0;
+        for (const auto& latencies : classes_) {
+            total += latencies.size();
+        }
+        for (int b = 0; b < Log2Histogram::kBuckets; ++b) {
+            std::vector<uint64_t>& latencies = classes_[b];
+            if (latencies.empty()) {
+                continue;
+            }
+            std::sort(latencies.begin(), latencies.end());
+            double sum = 0;
+            for (uint64_t latency : latencies) {
+                sum += latency;
+            }
+            size_t n = latencies.size();
+            fprintf(out, "size_class %llu-%llu B calls %zu share %.1f%% p50_ns %llu p99_ns %llu mean_ns %.0f\n",
+                    static_cast<unsigned long long>(b == 0 ? 0 : Log2Histogram::BucketUpperBound(b - 1) + 1),
+                    static_cast<unsigned long long>(Log2Histogram::BucketUpperBound(b)), n,
+                    100.0 * n / total, static_cast<unsigned long long>(latencies[n / 2]),
+                    static_cast<unsigned long long>(latencies[n * 99 / 100]), sum / n);
+        }
+    }
+
+private:
+    std::vector<uint64_t> classes_[Log2Histogram::kBuckets];
+};
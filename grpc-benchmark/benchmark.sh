@@ -15,14 +15,30 @@ cleanup() {
 }
 trap cleanup EXIT
 
-# start server
-./build/randombytes_server &
+# start server and wait until it reports readiness on fd 3
+READY_FIFO=$(mktemp -u)
+mkfifo "$READY_FIFO"
+start_ns=$(date +%s%N)
+./build/randombytes_server --ready_fd=3 3>"$READY_FIFO" &
 SERVER_PID=$!
+read -t 30 ready < "$READY_FIFO" || true
+ready_ns=$(date +%s%N)
+rm -f "$READY_FIFO"
 
-sleep 3 # wait for server to start
+if [ "$ready" != "READY=1" ]; then
+    echo "Error: server failed to start"
+    exit 1
+fi
+
+# startup metric: time from launch to listening, in microseconds
+ready_us=$(( (ready_ns - start_ns) / 1000 ))
+echo "$(date +%s) grpc $ready_us" >> startup.txt
+echo "server ready in $ready_us μs"
 
 main() {
     # bench_small
+    # bench_cpu
+    # bench_in_process
     bench_large
 }
 
@@ -32,11 +48,38 @@ bench_small() {
         for B in 1 32 1024; do
             for N in 100 1000 10000 25000; do
                 echo "running epoch $epoch with $B bytes and $N requests"
-                /usr/bin/time -v -o out.txt ./build/randombytes_client -n $N -b $B -t 0 -q
+                /usr/bin/time -v -o out.txt ./build/randombytes_client -n $N -b $B -t 0 -q \
+                    -o results.jsonl -L "small epoch=$epoch"
                 time=$(cat out.txt | grep "m:ss): " | cut -c 47-)
                 echo "$epoch $B $N $time" >> results.txt
-                
-                sleep 1 # small delay between requests
+            done
+        done
+    done
+}
+
+bench_in_process() {
+    # warm up until steady (5% CV), then 10 measured epochs in one process
+    for B in 1 32 1024; do
+        for N in 1000 10000 25000; do
+            echo "running in-process epochs with $B bytes and $N requests"
+            ./build/randombytes_client -n $N -b $B -t 0 -q -W 100 -V 5 -E 10 \
+                -o results.jsonl -L "in_process" | while read line; do
+                echo "$B $N $line" >> results_in_process.txt
+            done
+        done
+    done
+}
+
+bench_cpu() {
+    # CPU time per request and per MB on both sides, from getrusage snapshots
+    # the client takes of itself and of the server around each run
+    for epoch in 1 2 3 4 5 6 7 8 9 10; do
+        for B in 1 32 1024 1048576; do
+            for N in 1000 10000; do
+                echo "running epoch $epoch with CPU usage, $B bytes and $N requests"
+                ./build/randombytes_client -n $N -b $B -t 0 -q -C | while read line; do
+                    echo "$epoch $B $N $line" >> results_cpu.txt
+                done
             done
         done
     done
@@ -48,11 +91,10 @@ bench_large() {
         for B in $(numfmt --from=iec 10M 20M 30M 40M 50M); do
             for N in 10 25 50 100; do
                 echo "running epoch $epoch with $B bytes and $N requests"
-                /usr/bin/time -v -o out.txt ./build/randombytes_client -n $N -b $B -t 0 -q
+                /usr/bin/time -v -o out.txt ./build/randombytes_client -n $N -b $B -t 0 -q \
+                    -o results.jsonl -L "large epoch=$epoch"
                 time=$(cat out.txt | grep "m:ss): " | cut -c 47-)
                 echo "$epoch $B $N $time" >> results_large.txt
-                
-                sleep 1 # small delay between requests
             done
         done
     done
@@ -6,11 +6,19 @@ export MY_INSTALL_DIR=$HOME/.local
 export PATH="$MY_INSTALL_DIR/bin:$PATH"
 export PKG_CONFIG_PATH="$MY_INSTALL_DIR/lib/pkgconfig:$PKG_CONFIG_PATH"
 
-mkdir -p build
-cd build
+# ./build.sh static builds the static, LTO client into build-static instead
+BUILD_DIR=build
+EXTRA_FLAGS=""
+if [ "$1" == "static" ]; then
+    BUILD_DIR=build-static
+    EXTRA_FLAGS="-DRANDOMBYTES_STATIC_CLIENT=ON"
+fi
+
+mkdir -p $BUILD_DIR
+cd $BUILD_DIR
 
 echo "Configuring build..."
-cmake -DCMAKE_PREFIX_PATH=$MY_INSTALL_DIR ..
+cmake -DCMAKE_PREFIX_PATH=$MY_INSTALL_DIR $EXTRA_FLAGS ..
 
 echo "Building..."
 make -j$(nproc)
\ No newline at end of file
@@ -8,15 +8,24 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <chrono>
 #include <getopt.h>
 #include <cstdio>
 #include <cstdlib>
 
-#include "absl/flags/flag.h"
-#include "absl/flags/parse.h"
-
 #include "randombytes.grpc.pb.h"
+#include "client_driver.h"
+#include "clock.h"
+#include "cpu_affinity.h"
+#include "cpu_usage.h"
+#include "latency_split.h"
+#include "perf_counters.h"
+#include "probes.h"
+#include "results.h"
+#include "schedstat.h"
+#include "startup_timer.h"
 
 using grpc::Channel;
 using grpc::ClientContext;
@@ -24,18 +33,53 @@ using grpc::Status;
 using randombytes::RandomBytesService;
 using randombytes::RandomBytesRequest;
 using randombytes::RandomBytesReply;
-
-ABSL_FLAG(std::string, target, "localhost:50051", "Server address");
+using randombytes::ServerStatsRequest;
+using randombytes::ServerStatsReply;
 
 class RandomBytesClient {
  public:
   RandomBytesClient(std::shared_ptr<Channel> channel)
       : stub_(RandomBytesService::NewStub(channel)) {}
 
+  // Fetch the server's cumulative CPU usage
+  bool GetServerCpuUsage(CpuUsage* usage) {
+    ServerStatsReply reply;
+    if (!GetServerStats(&reply)) {
+      return false;
+    }
+    usage->user_us = reply.user_us();
+    usage->sys_us = reply.sys_us();
+    usage->voluntary_switches = reply.voluntary_switches();
+    usage->involuntary_switches = reply.involuntary_switches();
+    return true;
+  }
+
+  // Fetch the server's scheduler statistics, summed over its threads
+  bool GetServerSchedStat(SchedStat* sched) {
+    ServerStatsReply reply;
+    if (!GetServerStats(&reply)) {
+      return false;
+    }
+    sched->run_ns = reply.run_ns();
+    sched->wait_ns = reply.runqueue_ns();
+    sched->timeslices = reply.timeslices();
+    return true;
+  }
+
+  // Ask the server to stamp each reply so round trips can be split into
+  // request path, service and response path, with room for calls
+  void EnableTimestamps(size_t calls) {
+    timestamps_ = true;
+    latency_split_.Reserve(calls);
+  }
+
+  const LatencySplitStats& latency_split() const { return latency_split_; }
+
   // Request random bytes from the server
   bool GetRandomBytes(uint32_t num_bytes, int timeout_ms, bool log_output) {
     RandomBytesRequest request;
     request.set_num_bytes(num_bytes);
+    request.set_timestamps(timestamps_);
 
     RandomBytesReply reply;
     ClientContext context;
@@ -46,18 +90,24 @@ class RandomBytesClient {
       context.set_deadline(deadline);
     }
 
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
+    uint64_t start_time = BenchClock::Now();
+    uint64_t send_ns = timestamps_ ? clock_ns(CLOCK_MONOTONIC) : 0;
+
     // The actual RPC
+    RANDOMBYTES_PROBE(request_start, 0, num_bytes);
     Status status = stub_->GetRandomBytes(&context, request, &reply);
+    RANDOMBYTES_PROBE(response_received, 0, reply.actual_bytes());
+    if (timestamps_ && status.ok()) {
+      latency_split_.Add(send_ns, reply.server_receive_ns(), reply.server_send_ns(),
+                         clock_ns(CLOCK_MONOTONIC));
+    }
     
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    uint64_t duration_ns = BenchClock::ToNs(BenchClock::Now() - start_time);
 
     if (status.ok()) {
       if (log_output) {
-        std::cout << "Received " << reply.actual_bytes() << " random bytes in " 
-                  << duration.count() << " μs" << std::endl;
+        std::cout << "Received " << reply.actual_bytes() << " random bytes in "
+                  << duration_ns << " ns" << std::endl;
         
         // Print first few bytes as hex for verification
         const std::string& data = reply.data();
@@ -81,7 +131,21 @@ class RandomBytesClient {
   }
 
  private:
+  bool GetServerStats(ServerStatsReply* reply) {
+    ServerStatsRequest request;
+    ClientContext context;
+    Status status = stub_->GetServerStats(&context, request, reply);
+    if (!status.ok()) {
+      std::cerr << "GetServerStats failed: " << status.error_code() << ": "
+                << status.error_message() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
   std::unique_ptr<RandomBytesService::Stub> stub_;
+  bool timestamps_ = false;
+  LatencySplitStats latency_split_;
 };
 
 void print_usage(const char *program_name) {
@@ -93,14 +157,36 @@ void print_usage(const char *program_name) {
     printf("  -l, --log               Log output to stdout (default: enabled)\n");
     printf("  -q, --quiet             Disable logging to stdout\n");
     printf("  -s, --server ADDRESS    Server address (default: localhost:50051)\n");
+    printf("  -S, --startup-fd FD     Write startup phase timestamps to FD after the first call\n");
+    printf("  -P, --perf              Report hardware/software perf counters per call\n");
+    printf("  -C, --cpu-stats         Report client and server CPU time per call and per MB\n");
+    printf("  -o, --output FILE       Append a result record with latency percentiles and run\n");
+    printf("                          metadata to FILE (CSV if it ends in .csv, else JSON lines)\n");
+    printf("  -L, --label TEXT        Label stored in the result record, e.g. epoch=3\n");
+    printf("  -T, --trace-file FILE   Record every call's start, latency and status in a binary\n");
+    printf("                          trace (read with tools/trace_reader)\n");
+    printf("  -D, --sched-stats       Report client and server run time and run-queue wait per call\n");
+    printf("  -O, --one-way           Split round trips into request path, service and response\n");
+    printf("                          path using server timestamps\n");
+    printf("  -W, --warmup NUM        Untimed warm-up calls before the first epoch (default: 0)\n");
+    printf("  -V, --steady-cv PCT     After warm-up, keep warming up in batches until the mean\n");
+    printf("                          call time of the last 5 batches varies by at most PCT%%\n");
+    printf("  -E, --epochs NUM        Measured epochs of -n calls each in this process (default: 1)\n");
+    printf("  -A, --cpu LIST          Pin the client, gRPC's threads included, to CPUs in LIST\n");
+    printf("  -w, --workload SPEC     Draw request sizes from a distribution instead of -b:\n");
+    printf("                          SIZE:WEIGHT,..., loguniform:MIN:MAX or zipf:S:SIZE,...\n");
+    printf("  -R, --replay FILE       Replay a request trace (offset_ns,bytes,client CSV) with its\n");
+    printf("                          original pacing instead of making -n calls\n");
+    printf("  -j, --threads NUM       Replay threads (default: one per client id in the trace, 1 with -r)\n");
+    printf("  -r, --rate RPS          Open loop: issue -n requests at RPS per second (Poisson arrivals)\n");
+    printf("                          and measure latency from each request's scheduled time\n");
     printf("  -h, --help              Show this help message\n");
 }
 
 int main(int argc, char** argv) {
-    int iterations = 1;
-    int bytes = 10;
+    uint64_t main_ns = startup_monotonic_ns();
+    ClientOptions options;
     int timeout_ms = 0;
-    bool log_output = true;
     std::string server_address = "localhost:50051";
     
     static struct option long_options[] = {
@@ -110,6 +196,22 @@ int main(int argc, char** argv) {
         {"log", no_argument, 0, 'l'},
         {"quiet", no_argument, 0, 'q'},
         {"server", required_argument, 0, 's'},
+        {"startup-fd", required_argument, 0, 'S'},
+        {"perf", no_argument, 0, 'P'},
+        {"cpu-stats", no_argument, 0, 'C'},
+        {"one-way", no_argument, 0, 'O'},
+        {"sched-stats", no_argument, 0, 'D'},
+        {"output", required_argument, 0, 'o'},
+        {"label", required_argument, 0, 'L'},
+        {"trace-file", required_argument, 0, 'T'},
+        {"warmup", required_argument, 0, 'W'},
+        {"steady-cv", required_argument, 0, 'V'},
+        {"epochs", required_argument, 0, 'E'},
+        {"cpu", required_argument, 0, 'A'},
+        {"workload", required_argument, 0, 'w'},
+        {"replay", required_argument, 0, 'R'},
+        {"threads", required_argument, 0, 'j'},
+        {"rate", required_argument, 0, 'r'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -117,18 +219,18 @@ int main(int argc, char** argv) {
     int c;
     int option_index = 0;
     
-    while ((c = getopt_long(argc, argv, "n:b:t:lqs:h", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "n:b:t:lqs:S:PCODo:L:T:W:V:E:A:w:R:j:r:h", long_options, &option_index)) != -1) {
         switch (c) {
             case 'n':
-                iterations = atoi(optarg);
-                if (iterations <= 0) {
+                options.iterations = atoi(optarg);
+                if (options.iterations <= 0) {
                     fprintf(stderr, "Error: iterations must be positive\n");
                     return 1;
                 }
                 break;
             case 'b':
-                bytes = atoi(optarg);
-                if (bytes <= 0) {
+                options.bytes = atoi(optarg);
+                if (options.bytes <= 0) {
                     fprintf(stderr, "Error: bytes must be positive\n");
                     return 1;
                 }
@@ -141,14 +243,87 @@ int main(int argc, char** argv) {
                 }
                 break;
             case 'l':
-                log_output = true;
+                options.log_output = true;
                 break;
             case 'q':
-                log_output = false;
+                options.log_output = false;
                 break;
             case 's':
                 server_address = optarg;
                 break;
+            case 'S':
+                options.startup_fd = atoi(optarg);
+                break;
+            case 'P':
+                options.perf = true;
+                break;
+            case 'C':
+                options.cpu_stats = true;
+                break;
+            case 'O':
+                options.one_way = true;
+                break;
+            case 'D':
+                options.sched_stats = true;
+                break;
+            case 'o':
+                options.output_path = optarg;
+                break;
+            case 'L':
+                options.label = optarg;
+                break;
+            case 'T':
+                options.trace_path = optarg;
+                break;
+            case 'W':
+                options.warmup = atoi(optarg);
+                if (options.warmup < 0) {
+                    fprintf(stderr, "Error: warm-up calls must be non-negative\n");
+                    return 1;
+                }
+                break;
+            case 'V':
+                options.steady_cv = atof(optarg);
+                if (options.steady_cv <= 0) {
+                    fprintf(stderr, "Error: steady-state CV must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'E':
+                options.epochs = atoi(optarg);
+                if (options.epochs <= 0) {
+                    fprintf(stderr, "Error: epochs must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'A':
+                options.cpu_list = optarg;
+                break;
+            case 'w': {
+                std::string error;
+                if (!options.workload.Parse(optarg, &error)) {
+                    fprintf(stderr, "Error: invalid workload '%s': %s\n", optarg, error.c_str());
+                    return 1;
+                }
+                break;
+            }
+            case 'R':
+                options.replay_path = optarg;
+                break;
+            case 'j':
+                options.replay_threads = atoi(optarg);
+                if (options.replay_threads <= 0) {
+                    fprintf(stderr, "Error: threads must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'r':
+                options.rate = atof(optarg);
+                if (options.rate <= 0) {
+                    fprintf(stderr, "Error: rate must be positive\n");
+                    return 1;
+                }
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -159,52 +334,64 @@ int main(int argc, char** argv) {
                 abort();
         }
     }
+
+    if (!check_replay_options(options)) {
+        return 1;
+    }
     
-    if (log_output) {
+    if (options.log_output) {
         std::cout << "gRPC Random Bytes Client" << std::endl;
         std::cout << "Server: " << server_address << std::endl;
-        std::cout << "Iterations: " << iterations << std::endl;
-        std::cout << "Bytes per call: " << bytes << std::endl;
+        print_run_plan(options);
         std::cout << "Timeout: " << (timeout_ms > 0 ? std::to_string(timeout_ms) + "ms" : "none") << std::endl;
         std::cout << "---" << std::endl;
     }
 
+    // Before the channel starts gRPC's threads, so they inherit the mask
+    if (!options.cpu_list.empty() && !pin_to_cpus(options.cpu_list)) {
+        return 1;
+    }
+
     // Create client with 100MB message size limit
     grpc::ChannelArguments args;
     const int max_message_size = 100 * 1024 * 1024; // 100MB
     args.SetMaxReceiveMessageSize(max_message_size);
     args.SetMaxSendMessageSize(max_message_size);
-    
-    RandomBytesClient client(
-        grpc::CreateCustomChannel(server_address, grpc::InsecureChannelCredentials(), args));
 
-    int successful_calls = 0;
-    auto total_start = std::chrono::high_resolution_clock::now();
-    
-    // Make the specified number of calls
-    for (int i = 0; i < iterations; ++i) {
-        if (log_output && iterations > 1) {
-            std::cout << "Call " << (i + 1) << "/" << iterations << ": ";
-        }
-        
-        if (client.GetRandomBytes(bytes, timeout_ms, log_output)) {
-            successful_calls++;
-        }
+    // Replay a request trace or an open-loop schedule instead of the fixed
+    // loop; each thread gets its own client
+    if (options.replay_mode()) {
+        // One channel; every thread's stub multiplexes over it
+        std::shared_ptr<Channel> channel =
+            grpc::CreateCustomChannel(server_address, grpc::InsecureChannelCredentials(), args);
+        return run_replay_mode(options, "grpc", [&]() {
+            auto caller = std::make_shared<RandomBytesClient>(channel);
+            return [caller, timeout_ms](uint32_t num_bytes) {
+                return caller->GetRandomBytes(num_bytes, timeout_ms, false);
+            };
+        }, [&](ResultRecord& record) {
+            record.Add("server", server_address);
+        });
     }
     
-    auto total_end = std::chrono::high_resolution_clock::now();
-    auto total_duration = std::chrono::duration_cast<std::chrono::microseconds>(total_end - total_start);
-    
-    if (log_output) {
-        std::cout << "---" << std::endl;
-        std::cout << "Summary:" << std::endl;
-        std::cout << "Successful calls: " << successful_calls << "/" << iterations << std::endl;
-        std::cout << "Total time: " << total_duration.count() << " μs" << std::endl;
-        if (iterations > 1) {
-            std::cout << "Average time per call: " << (total_duration.count() / iterations) << " μs" << std::endl;
-        }
-        std::cout << "Success rate: " << (100.0 * successful_calls / iterations) << "%" << std::endl;
+    StartupReport startup(options.startup_fd);
+    startup.Mark("main", main_ns);
+
+    // gRPC does part of each call on its own threads, so count the whole
+    // process; the counters must be opened before the channel starts them
+    PerfCounters perf_counters;
+    if (options.perf) {
+        perf_counters.Open(PerfCounters::kProcess);
     }
 
-    return (successful_calls == iterations) ? 0 : 1;
-}
\ No newline at end of file
+    RandomBytesClient client(
+        grpc::CreateCustomChannel(server_address, grpc::InsecureChannelCredentials(), args));
+    startup.Mark("transport");
+
+    return run_closed_loop(options, "grpc", client, [&](uint32_t num_bytes, bool log) {
+        return client.GetRandomBytes(num_bytes, timeout_ms, log);
+    }, startup, perf_counters, [&](ResultRecord& record) {
+        record.Add("server", server_address);
+        record.Add("timeout_ms", static_cast<uint64_t>(timeout_ms));
+    });
+}
@@ -7,11 +7,16 @@
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/health_check_service_interface.h>
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
+#include <signal.h>
 #include <sys/random.h>
+#include <sys/socket.h>
+#include <time.h>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
@@ -19,6 +24,13 @@
 #include "absl/strings/str_format.h"
 
 #include "randombytes.grpc.pb.h"
+#include "cpu_affinity.h"
+#include "cpu_usage.h"
+#include "metrics.h"
+#include "perf_counters.h"
+#include "probes.h"
+#include "readiness.h"
+#include "schedstat.h"
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -27,14 +39,64 @@ using grpc::Status;
 using randombytes::RandomBytesService;
 using randombytes::RandomBytesRequest;
 using randombytes::RandomBytesReply;
+using randombytes::ServerStatsRequest;
+using randombytes::ServerStatsReply;
 
 ABSL_FLAG(uint16_t, port, 50051, "Server port for the service");
+ABSL_FLAG(int, ready_fd, -1,
+          "Write READY=1 to this fd once listening (NOTIFY_SOCKET is honoured too)");
+ABSL_FLAG(bool, perf, false, "Count perf events and report them per request on shutdown");
+ABSL_FLAG(std::string, metrics, "",
+          "Serve Prometheus metrics on a Unix socket path, HOST:PORT or a port on 127.0.0.1");
+ABSL_FLAG(std::string, cpu, "", "Pin the server, gRPC's threads included, to these CPUs (e.g. 2 or 0-3,8)");
+
+uint64_t monotonic_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
 
 // Logic and data behind the server's behavior.
 class RandomBytesServiceImpl final : public RandomBytesService::Service {
+ public:
+  uint64_t requests() const { return requests_.load(std::memory_order_relaxed); }
+
+  std::string RenderMetrics() const {
+    MetricsText text;
+    metrics_.Render(text);
+    text.Gauge("randombytes_inflight_requests", "Requests being served right now.",
+               inflight_.load(std::memory_order_relaxed));
+    return text.str();
+  }
+
+ private:
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<int64_t> inflight_{0};
+  ServerMetrics metrics_;
+
   Status GetRandomBytes(ServerContext* context, const RandomBytesRequest* request,
                        RandomBytesReply* reply) override {
+    uint64_t start = monotonic_ns();
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    inflight_.fetch_add(1, std::memory_order_relaxed);
+    Status status = ServeRandomBytes(request, reply);
+    inflight_.fetch_sub(1, std::memory_order_relaxed);
+    if (request->timestamps()) {
+      reply->set_server_receive_ns(start);
+      reply->set_server_send_ns(monotonic_ns());
+    }
+    // gRPC serialises and sends the reply after the handler returns, so
+    // this marks the hand-off to gRPC rather than the write itself
+    RANDOMBYTES_PROBE(response_sent, 0, request->num_bytes());
+    if (status.ok()) {
+      metrics_.RecordRequest(request->num_bytes(), monotonic_ns() - start);
+    }
+    return status;
+  }
+
+  Status ServeRandomBytes(const RandomBytesRequest* request, RandomBytesReply* reply) {
     uint32_t num_bytes = request->num_bytes();
+    RANDOMBYTES_PROBE(request_start, 0, num_bytes);
     
     // Limit the maximum number of bytes to prevent abuse
     // const uint32_t MAX_BYTES = 1024 * 1024; // 1MB limit
@@ -52,8 +114,10 @@ class RandomBytesServiceImpl final : public RandomBytesService::Service {
     std::vector<uint8_t> buffer(num_bytes);
     
     // Use getrandom() syscall to get truly random bytes
+    uint64_t getrandom_start = monotonic_ns();
     ssize_t result = getrandom(buffer.data(), num_bytes, GRND_NONBLOCK);
-    
+    metrics_.RecordGetrandom(num_bytes, monotonic_ns() - getrandom_start, result == num_bytes);
+
     if (result < 0) {
       return Status(grpc::StatusCode::INTERNAL, 
                    "Failed to generate random bytes: " + std::string(strerror(errno)));
@@ -64,18 +128,43 @@ class RandomBytesServiceImpl final : public RandomBytesService::Service {
                    "Failed to generate random bytes: " + std::string(strerror(errno)));
     }
 
+    RANDOMBYTES_PROBE(entropy_generated, 0, num_bytes);
+
     // Set the random bytes in the reply
     reply->set_data(buffer.data(), result);
     reply->set_actual_bytes(static_cast<uint32_t>(result));
     
     return Status::OK;
   }
+
+  Status GetServerStats(ServerContext* context, const ServerStatsRequest* request,
+                        ServerStatsReply* reply) override {
+    CpuUsage usage = read_cpu_usage();
+    reply->set_user_us(usage.user_us);
+    reply->set_sys_us(usage.sys_us);
+    reply->set_voluntary_switches(usage.voluntary_switches);
+    reply->set_involuntary_switches(usage.involuntary_switches);
+    SchedStat sched;
+    read_sched_stat(&sched);
+    reply->set_run_ns(sched.run_ns);
+    reply->set_runqueue_ns(sched.wait_ns);
+    reply->set_timeslices(sched.timeslices);
+    return Status::OK;
+  }
 };
 
-void RunServer(uint16_t port) {
+void RunServer(uint16_t port, int ready_fd, bool perf, const std::string& metrics_address) {
   std::string server_address = absl::StrFormat("0.0.0.0:%d", port);
   RandomBytesServiceImpl service;
 
+  // Requests are served on gRPC's own threads, so count the whole process.
+  // The counters are inherited only by threads created after this point.
+  PerfCounters perf_counters;
+  if (perf) {
+    perf_counters.Open(PerfCounters::kProcess);
+    perf_counters.Start();
+  }
+
   grpc::EnableDefaultHealthCheckService(true);
   grpc::reflection::InitProtoReflectionServerBuilderPlugin();
   ServerBuilder builder;
@@ -92,16 +181,85 @@ void RunServer(uint16_t port) {
   builder.RegisterService(&service);
   // Finally assemble the server.
   std::unique_ptr<Server> server(builder.BuildAndStart());
+  if (!server) {
+    std::cerr << "Failed to start server on " << server_address << std::endl;
+    return;
+  }
   std::cout << "RandomBytes Server listening on " << server_address << std::endl;
 
+  // Scrapes are served one at a time on their own thread, away from the
+  // gRPC threads
+  int metrics_fd = -1;
+  std::thread metrics_thread;
+  if (!metrics_address.empty()) {
+    metrics_fd = create_metrics_listener(metrics_address);
+    if (metrics_fd < 0) {
+      server->Shutdown();
+      return;
+    }
+    metrics_thread = std::thread([metrics_fd, &service]() {
+      int scrape_fd;
+      while ((scrape_fd = accept4(metrics_fd, NULL, NULL, SOCK_CLOEXEC)) >= 0 || errno == EINTR) {
+        if (scrape_fd >= 0) {
+          serve_metrics_client(scrape_fd, service.RenderMetrics());
+        }
+      }
+    });
+  }
+  notify_ready(ready_fd);
+
+  // Shut down on SIGINT/SIGTERM so end-of-run statistics are printed. The
+  // signals are blocked in main() and only delivered to this thread.
+  std::thread shutdown_thread([&server]() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    int sig;
+    sigwait(&signals, &sig);
+    server->Shutdown();
+  });
+
   // Wait for the server to shutdown. Note that some other thread must be
   // responsible for shutting down the server for this call to ever return.
   server->Wait();
+  shutdown_thread.join();
+  std::cout << "Server shutting down..." << std::endl;
+
+  if (metrics_fd >= 0) {
+    // Wakes up the blocked accept()
+    shutdown(metrics_fd, SHUT_RDWR);
+    metrics_thread.join();
+    close(metrics_fd);
+    if (metrics_address.find('/') != std::string::npos) {
+      unlink(metrics_address.c_str());
+    }
+  }
+
+  if (perf) {
+    perf_counters.Stop();
+    print_perf_report(stdout, "server", perf_counters, perf_counters.Read(), service.requests());
+  }
 }
 
 int main(int argc, char** argv) {
   absl::ParseCommandLine(argc, argv);
   absl::InitializeLog();
-  RunServer(absl::GetFlag(FLAGS_port));
+
+  // Before gRPC starts any threads, they inherit the mask
+  std::string cpu_list = absl::GetFlag(FLAGS_cpu);
+  if (!cpu_list.empty() && !pin_to_cpus(cpu_list)) {
+    return 1;
+  }
+
+  // Block shutdown signals before gRPC starts any threads, they inherit the mask
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  RunServer(absl::GetFlag(FLAGS_port), absl::GetFlag(FLAGS_ready_fd),
+            absl::GetFlag(FLAGS_perf), absl::GetFlag(FLAGS_metrics));
   return 0;
 }
\ No newline at end of file
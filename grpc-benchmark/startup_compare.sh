@@ -0,0 +1,51 @@
+#! /bin/bash
+set -e # exit on error
+# set -x # print commands
+
+# compare cold-start time of the dynamic (build/) and static LTO
+# (build-static/, see ./build.sh static) clients using tools/coldstart.
+# Library static init is in load_init for the dynamic client but in pre_main
+# for the static one, so compare load_init + pre_main between the two.
+
+COLDSTART=../tools/build/coldstart
+REPETITIONS=200
+
+if [ ! -x "$COLDSTART" ]; then
+    echo "build the tools first: cd ../tools && mkdir -p build && cd build && cmake .. && make"
+    exit 1
+fi
+
+# kill any existing process listening on port 50051
+lsof -ti:50051 | xargs -r kill -9
+
+cleanup() {
+    echo "Cleaning up..."
+    if [ ! -z "$SERVER_PID" ]; then
+        kill $SERVER_PID 2>/dev/null || true
+    fi
+}
+trap cleanup EXIT
+
+# start server and wait until it reports readiness on fd 3
+READY_FIFO=$(mktemp -u)
+mkfifo "$READY_FIFO"
+./build/randombytes_server --ready_fd=3 3>"$READY_FIFO" &
+SERVER_PID=$!
+read -t 30 ready < "$READY_FIFO" || true
+rm -f "$READY_FIFO"
+if [ "$ready" != "READY=1" ]; then
+    echo "Error: server failed to start"
+    exit 1
+fi
+
+for variant in build build-static; do
+    echo "file $variant/randombytes_client: $(file -b $variant/randombytes_client | cut -d, -f1-4)"
+    echo "size: $(stat -c %s $variant/randombytes_client) bytes"
+    $COLDSTART -r $REPETITIONS -L 20 -l "$variant" -- \
+        ./$variant/randombytes_client -n 1 -b 32 -q -S 3 >> startup_compare.txt
+done
+
+# median lines: label median total_us T exec E load_init L ...
+grep "^#" startup_compare.txt | tail -n 4
+echo "results saved to startup_compare.txt (variant run total_us exec load_init pre_main transport_init first_call exit)"
+echo "library static init is in load_init for build/ and in pre_main for build-static/; compare their sum"
@@ -31,19 +31,26 @@ if [ ! -d "build" ]; then
     cd ..
 fi
 
-# Start the socket server
-./build/socket_server -s "$SOCKET_PATH" &
+# Start the socket server and wait until it reports readiness on fd 3
+READY_FIFO=$(mktemp -u)
+mkfifo "$READY_FIFO"
+start_ns=$(date +%s%N)
+./build/socket_server -s "$SOCKET_PATH" --ready-fd 3 3>"$READY_FIFO" &
 SERVER_PID=$!
+read -t 30 ready < "$READY_FIFO" || true
+ready_ns=$(date +%s%N)
+rm -f "$READY_FIFO"
 
-# Wait for server to start up
-sleep 2
-
-# Check if server is still running
-if ! kill -0 $SERVER_PID 2>/dev/null; then
+if [ "$ready" != "READY=1" ]; then
     echo "Error: Server failed to start"
     exit 1
 fi
 
+# Startup metric: time from launch to listening, in microseconds
+ready_us=$(( (ready_ns - start_ns) / 1000 ))
+echo "$(date +%s) socket $ready_us" >> startup.txt
+echo "Server ready in $ready_us μs"
+
 echo "Running socket benchmark..."
 echo "Socket path: $SOCKET_PATH"
 echo "Server PID: $SERVER_PID"
@@ -51,6 +58,10 @@ echo ""
 
 main() {
     # bench_small
+    # bench_cpu
+    # bench_modes
+    # bench_in_process
+    # bench_mixed
     bench_large
 }
 
@@ -60,7 +71,8 @@ bench_small() {
         for B in 1 32 1024; do
             for N in 100 1000 10000 25000 50000 100000; do
                 echo "Running epoch $epoch: $N iterations, $B bytes per call"
-                /usr/bin/time -v -o out.txt ./build/socket_client -n $N -b $B -t 0 -q -s "$SOCKET_PATH"
+                /usr/bin/time -v -o out.txt ./build/socket_client -n $N -b $B -t 0 -q -s "$SOCKET_PATH" \
+                    -o results.jsonl -L "small epoch=$epoch"
                 time=$(cat out.txt | grep "m:ss): " | cut -c 47-)
                 echo "$epoch $B $N $time" >> results.txt
                 rm -f out.txt
@@ -70,17 +82,82 @@ bench_small() {
     echo "Small benchmark completed. Results saved to results.txt"
 }
 
+bench_modes() {
+    # Compare connect-per-call, pre-connected pool and persistent connections
+    for epoch in 1 2 3 4 5 6 7 8 9 10; do
+        for MODE in connect pool persistent; do
+            for B in 1 32 1024; do
+                for N in 1000 10000 50000; do
+                    echo "Running epoch $epoch: $MODE mode, $N iterations, $B bytes per call"
+                    /usr/bin/time -v -o out.txt ./build/socket_client -n $N -b $B -t 0 -q -m $MODE -p 16 -s "$SOCKET_PATH" \
+                        -o results.jsonl -L "modes epoch=$epoch"
+                    time=$(cat out.txt | grep "m:ss): " | cut -c 47-)
+                    echo "$epoch $MODE $B $N $time" >> results_modes.txt
+                    rm -f out.txt
+                done
+            done
+        done
+    done
+    echo "Connection mode benchmark completed. Results saved to results_modes.txt"
+}
+
+bench_in_process() {
+    # One process per configuration: warm up until steady (5% CV), then 10
+    # measured epochs. Startup is reported on its own instead of being part
+    # of every measurement.
+    for B in 1 32 1024; do
+        for N in 1000 10000 50000; do
+            echo "Running in-process epochs: $N iterations, $B bytes per call"
+            ./build/socket_client -n $N -b $B -t 0 -q -m persistent -s "$SOCKET_PATH" -W 100 -V 5 -E 10 \
+                -o results.jsonl -L "in_process" | while read line; do
+                echo "$B $N $line" >> results_in_process.txt
+            done
+        done
+    done
+    echo "In-process benchmark completed. Results saved to results_in_process.txt and results.jsonl"
+}
+
+bench_mixed() {
+    # Production-like size mixes: mostly nonces with occasional bulk pulls
+    for epoch in 1 2 3 4 5 6 7 8 9 10; do
+        for WORKLOAD in "32:90,65536:9,4194304:1" "loguniform:16:1048576" "zipf:1.2:16,32,64,1024,65536,1048576"; do
+            echo "Running epoch $epoch: workload $WORKLOAD"
+            ./build/socket_client -n 10000 -t 0 -q -m persistent -s "$SOCKET_PATH" -w "$WORKLOAD" \
+                -o results.jsonl -L "mixed epoch=$epoch" | while read line; do
+                echo "$epoch $WORKLOAD $line" >> results_mixed.txt
+            done
+        done
+    done
+    echo "Mixed workload benchmark completed. Results saved to results_mixed.txt (epoch workload size_class ...)"
+}
+
+bench_cpu() {
+    # CPU time per request and per MB on both sides, from getrusage snapshots
+    # the client takes of itself and of the server around each run
+    for epoch in 1 2 3 4 5 6 7 8 9 10; do
+        for B in 1 32 1024 1048576; do
+            for N in 1000 10000; do
+                echo "Running epoch $epoch: CPU usage, $N iterations, $B bytes per call"
+                ./build/socket_client -n $N -b $B -t 0 -q -C -s "$SOCKET_PATH" | while read line; do
+                    echo "$epoch $B $N $line" >> results_cpu.txt
+                done
+            done
+        done
+    done
+    echo "CPU usage benchmark completed. Results saved to results_cpu.txt (epoch bytes iterations side key value ...)"
+}
+
 bench_large() {
     # Run large benchmark with same parameters as gRPC and D-Bus benchmarks
     for epoch in 1 2 3; do
         for B in $(numfmt --from=iec 10M 20M 30M 40M 50M); do
             for N in 10 25 50 100; do
                 echo "Running epoch $epoch: $N iterations, $B bytes per call"
-                /usr/bin/time -v -o out.txt ./build/socket_client -n $N -b $B -t 0 -q -s "$SOCKET_PATH"
+                /usr/bin/time -v -o out.txt ./build/socket_client -n $N -b $B -t 0 -q -s "$SOCKET_PATH" \
+                    -o results.jsonl -L "large epoch=$epoch"
                 time=$(cat out.txt | grep "m:ss): " | cut -c 47-)
                 echo "$epoch $B $N $time" >> results_large.txt
                 rm -f out.txt
-                sleep 1 # small delay between requests
             done
         done
     done
@@ -0,0 +1,92 @@
+#!/bin/bash
+set -e # exit on error
+# set -x # print commands
+
+# Restart the server repeatedly while clients are under load and count the
+# requests that fail. Hot restart hands the listening socket (and, for
+# persistent clients, the connections) to the new process over SCM_RIGHTS;
+# a cold restart kills the server and binds the path again.
+
+SOCKET_PATH="/tmp/randombytes_socket"
+RESTARTS=10
+
+# Build the project if build directory doesn't exist
+if [ ! -d "build" ]; then
+    echo "Building socket benchmark..."
+    mkdir -p build
+    cd build
+    cmake ..
+    make -j$(nproc)
+    cd ..
+fi
+
+cleanup() {
+    pkill -f "socket_server -s $SOCKET_PATH" 2>/dev/null || true
+    rm -f "$SOCKET_PATH" "$SOCKET_PATH.handoff" client.log
+}
+trap cleanup EXIT
+
+# Start a server with a readiness pipe on fd 3 and wait for READY=1, which
+# it writes once it is listening (or, with -r, has taken over the listener)
+start_server() {
+    local fifo=$(mktemp -u)
+    mkfifo "$fifo"
+    ./build/socket_server -s "$SOCKET_PATH" --ready-fd 3 "$@" 3>"$fifo" > /dev/null &
+    SERVER_PID=$!
+    read -t 30 ready < "$fifo" || true
+    rm -f "$fifo"
+    if [ "$ready" != "READY=1" ]; then
+        echo "Error: socket_server failed to start"
+        exit 1
+    fi
+}
+
+restart_hot() {
+    old_pid=$SERVER_PID
+    start_server -r -c
+    # The old server exits once the handoff is done and its connections drained
+    wait $old_pid 2>/dev/null || true
+}
+
+restart_cold() {
+    kill $SERVER_PID; wait $SERVER_PID 2>/dev/null || true
+    start_server
+}
+
+run() {
+    local kind=$1 mode=$2 N=$3
+    rm -f "$SOCKET_PATH" "$SOCKET_PATH.handoff"
+    if [ "$kind" == "hot" ]; then
+        start_server -r -c
+    else
+        start_server
+    fi
+
+    ./build/socket_client -n $N -b 32 -q -m $mode -s "$SOCKET_PATH" 2> client.log &
+    CLIENT_PID=$!
+
+    for i in $(seq $RESTARTS); do
+        sleep 0.2
+        restart_$kind
+    done
+
+    wait $CLIENT_PID || true
+    failed=$(grep "Failed calls:" client.log | awk '{print $3}' | cut -d/ -f1)
+    echo "$kind $mode $N $RESTARTS ${failed:-0}" >> results_restart.txt
+    echo "$kind restart, $mode mode: ${failed:-0} of $N requests failed across $RESTARTS restarts"
+
+    kill $SERVER_PID 2>/dev/null || true
+    wait $SERVER_PID 2>/dev/null || true
+}
+
+main() {
+    for epoch in 1 2 3; do
+        for MODE in connect persistent; do
+            run hot $MODE 200000
+            run cold $MODE 200000
+        done
+    done
+    echo "Hot restart benchmark completed. Results saved to results_restart.txt (restart mode iterations restarts failed)"
+}
+
+main
@@ -0,0 +1,92 @@
+#!/bin/bash
+set -e # exit on error
+# set -x # print commands
+
+# C10K benchmark: server memory and event loop cost per idle connection, and
+# the latency an active client sees while the idle connections are held
+
+SOCKET_PATH="/tmp/randombytes_socket"
+
+# Build the project if build directory doesn't exist
+if [ ! -d "build" ]; then
+    echo "Building socket benchmark..."
+    mkdir -p build
+    cd build
+    cmake ..
+    make -j$(nproc)
+    cd ..
+fi
+
+cleanup() {
+    if [ ! -z "$HOLDER_PID" ]; then
+        kill $HOLDER_PID 2>/dev/null || true
+    fi
+    if [ ! -z "$SERVER_PID" ]; then
+        kill $SERVER_PID 2>/dev/null || true
+    fi
+    rm -f "$SOCKET_PATH" server.log holder.log out.txt ready.fifo
+}
+trap cleanup EXIT
+
+# Resident set size of a process in kB
+rss_kb() {
+    grep VmRSS /proc/$1/status | awk '{print $2}'
+}
+
+# Wait until a log file contains a line matching a pattern
+wait_for_line() {
+    until grep -q "$2" "$1" 2>/dev/null; do
+        sleep 0.1
+    done
+}
+
+main() {
+    for epoch in 1 2 3; do
+        for C in 0 10000 25000 50000 100000; do
+            rm -f "$SOCKET_PATH"
+            mkfifo ready.fifo
+            ./build/socket_server -s "$SOCKET_PATH" --ready-fd 3 3>ready.fifo > server.log &
+            SERVER_PID=$!
+            read -t 30 ready < ready.fifo || true
+            rm -f ready.fifo
+            if [ "$ready" != "READY=1" ]; then
+                echo "Error: socket_server failed to start"
+                exit 1
+            fi
+            rss_before=$(rss_kb $SERVER_PID)
+
+            ./build/socket_idle_clients -c $C -s "$SOCKET_PATH" > holder.log &
+            HOLDER_PID=$!
+            wait_for_line holder.log "Holding"
+            sleep 1 # let the server accept the tail of the backlog
+            rss_after=$(rss_kb $SERVER_PID)
+
+            for B in 1 32 1024; do
+                N=10000
+                echo "Running epoch $epoch: $C idle connections, $N iterations, $B bytes per call"
+                /usr/bin/time -v -o out.txt ./build/socket_client -n $N -b $B -t 0 -q -m persistent -s "$SOCKET_PATH"
+                time=$(cat out.txt | grep "m:ss): " | cut -c 47-)
+                echo "$epoch $C $B $N $time" >> results_idle.txt
+            done
+
+            kill $HOLDER_PID; wait $HOLDER_PID 2>/dev/null || true
+            HOLDER_PID=""
+            kill $SERVER_PID; wait $SERVER_PID 2>/dev/null || true
+            SERVER_PID=""
+
+            # Event loop: W wake-ups, E events, T ns per wake-up, ...
+            loop_stats=$(grep "Event loop:" server.log | awk '{print $3, $5, $7}')
+            if [ $C -gt 0 ]; then
+                per_conn=$(( (rss_after - rss_before) * 1024 / C ))
+            else
+                per_conn=0
+            fi
+            echo "$epoch $C $rss_before $rss_after $per_conn $loop_stats" >> results_idle_memory.txt
+        done
+    done
+    echo "Idle connection benchmark completed."
+    echo "Latency results saved to results_idle.txt (epoch connections bytes iterations time)"
+    echo "Memory results saved to results_idle_memory.txt (epoch connections rss_before_kb rss_after_kb bytes_per_connection wakeups events ns_per_wakeup)"
+}
+
+main
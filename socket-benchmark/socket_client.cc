@@ -7,7 +7,7 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <chrono>
+#include <algorithm>
 #include <getopt.h>
 #include <cstdio>
 #include <cstdlib>
@@ -16,114 +16,329 @@
 #include <unistd.h>
 #include <cstring>
 #include <cerrno>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
-// Protocol definition (must match server)
-struct RandomBytesRequest {
-    uint32_t num_bytes;
-};
+#include "client_driver.h"
+#include "clock.h"
+#include "cpu_affinity.h"
+#include "cpu_usage.h"
+#include "latency_split.h"
+#include "perf_counters.h"
+#include "probes.h"
+#include "results.h"
+#include "schedstat.h"
+#include "socket_protocol.h"
+#include "startup_timer.h"
+
+const char* SOCKET_PATH = "/tmp/randombytes_socket";
 
-struct RandomBytesResponse {
-    uint32_t actual_bytes;
-    // followed by actual_bytes of data
+// How the client obtains a connection for each request
+enum class ConnectionMode {
+    kConnectPerCall,  // socket()+connect() inside every timed call
+    kPersistent,      // one connection reused for all calls
+    kPool,            // pre-connected sockets, one per call, refilled in background
 };
 
-const char* SOCKET_PATH = "/tmp/randombytes_socket";
+bool parse_connection_mode(const std::string& name, ConnectionMode* mode) {
+    if (name == "connect") {
+        *mode = ConnectionMode::kConnectPerCall;
+    } else if (name == "persistent") {
+        *mode = ConnectionMode::kPersistent;
+    } else if (name == "pool") {
+        *mode = ConnectionMode::kPool;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-class SocketRandomBytesClient {
+// Open a new connection to the server, returns -1 on failure
+int connect_to_server(const std::string& socket_path, bool log_output) {
+    int sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock_fd < 0) {
+        if (log_output) {
+            std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
+        }
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (connect(sock_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        if (log_output) {
+            std::cerr << "Failed to connect to server: " << strerror(errno) << std::endl;
+        }
+        close(sock_fd);
+        return -1;
+    }
+
+    return sock_fd;
+}
+
+// Keeps up to pool_size already-connected sockets ready for use. Sockets are
+// handed out in the order they were connected, which is also the order the
+// server accepts them in.
+class ConnectionPool {
 private:
     std::string socket_path_;
+    size_t pool_size_;
+    std::deque<int> ready_;
+    std::mutex mutex_;
+    std::condition_variable refill_cv_;
+    std::condition_variable ready_cv_;
+    bool stopping_ = false;
+    bool failed_ = false;
+    std::thread refill_thread_;
 
-public:
-    SocketRandomBytesClient(const std::string& socket_path) 
-        : socket_path_(socket_path) {}
+    void RefillLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            if (ready_.size() >= pool_size_) {
+                refill_cv_.wait(lock);
+                continue;
+            }
 
-    // Request random bytes from the server
-    bool GetRandomBytes(uint32_t num_bytes, bool log_output) {
-        // Create socket
-        int sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
-        if (sock_fd < 0) {
-            if (log_output) {
-                std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
+            // Connect without holding the lock so Acquire() is never blocked
+            // behind a connect() call
+            lock.unlock();
+            int sock_fd = connect_to_server(socket_path_, false);
+            lock.lock();
+
+            if (sock_fd < 0) {
+                failed_ = true;
+                ready_cv_.notify_all();
+                return;
             }
-            return false;
+            ready_.push_back(sock_fd);
+            ready_cv_.notify_one();
         }
+    }
 
-        // Connect to server
-        struct sockaddr_un addr;
-        memset(&addr, 0, sizeof(addr));
-        addr.sun_family = AF_UNIX;
-        strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
-
-        auto start_time = std::chrono::high_resolution_clock::now();
+public:
+    ConnectionPool(const std::string& socket_path, size_t pool_size)
+        : socket_path_(socket_path), pool_size_(pool_size) {
+        refill_thread_ = std::thread(&ConnectionPool::RefillLoop, this);
+    }
 
-        if (connect(sock_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-            if (log_output) {
-                std::cerr << "Failed to connect to server: " << strerror(errno) << std::endl;
-            }
+    ~ConnectionPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        refill_cv_.notify_all();
+        refill_thread_.join();
+        for (int sock_fd : ready_) {
             close(sock_fd);
+        }
+    }
+
+    // Take a connected socket, waiting for the refill thread if the pool is
+    // empty. Returns -1 if the refill thread could not connect.
+    int Acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_cv_.wait(lock, [this] { return !ready_.empty() || failed_; });
+        if (ready_.empty()) {
+            return -1;
+        }
+        int sock_fd = ready_.front();
+        ready_.pop_front();
+        refill_cv_.notify_one();
+        return sock_fd;
+    }
+};
+
+class SocketRandomBytesClient {
+private:
+    std::string socket_path_;
+    ConnectionMode mode_;
+    int persistent_fd_ = -1;
+    std::unique_ptr<ConnectionPool> pool_;
+    bool timestamps_ = false;
+    LatencySplitStats latency_split_;
+
+    // Send a control request with a fixed-size reply over a new connection
+    bool Control(uint32_t op, void* reply, size_t reply_size, const char* what) {
+        int sock_fd = connect_to_server(socket_path_, true);
+        if (sock_fd < 0) {
+            return false;
+        }
+
+        std::vector<uint8_t> data;
+        uint32_t actual_bytes = 0;
+        bool ok = Exchange(sock_fd, CONTROL_REQUEST_FLAG | op, data, &actual_bytes, true);
+        close(sock_fd);
+        if (!ok || actual_bytes != reply_size) {
+            std::cerr << "Server did not answer the " << what << " request" << std::endl;
             return false;
         }
+        memcpy(reply, data.data(), reply_size);
+        return true;
+    }
 
-        // Send request
+    // Send one request on an open connection and read the full response
+    bool Exchange(int sock_fd, uint32_t num_bytes, std::vector<uint8_t>& data,
+                  uint32_t* actual_bytes, bool log_output) {
+        // Send request. Control requests are never stamped.
+        bool stamp = timestamps_ && !(num_bytes & CONTROL_REQUEST_FLAG);
         RandomBytesRequest request;
-        request.num_bytes = num_bytes;
+        request.num_bytes = num_bytes | (stamp ? TIMESTAMPS_REQUEST_FLAG : 0);
 
-        ssize_t bytes_sent = send(sock_fd, &request, sizeof(request), 0);
+        RANDOMBYTES_PROBE(request_start, sock_fd, num_bytes);
+        uint64_t send_ns = stamp ? clock_ns(CLOCK_MONOTONIC) : 0;
+        ssize_t bytes_sent = send(sock_fd, &request, sizeof(request), MSG_NOSIGNAL);
         if (bytes_sent != sizeof(request)) {
             if (log_output) {
                 std::cerr << "Failed to send request: " << strerror(errno) << std::endl;
             }
-            close(sock_fd);
             return false;
         }
 
         // Receive response header
         RandomBytesResponse response;
-        ssize_t bytes_received = recv(sock_fd, &response, sizeof(response), 0);
+        ssize_t bytes_received = recv(sock_fd, &response, sizeof(response), MSG_WAITALL);
         if (bytes_received != sizeof(response)) {
             if (log_output) {
                 std::cerr << "Failed to receive response header: " << strerror(errno) << std::endl;
             }
-            close(sock_fd);
+            return false;
+        }
+
+        ServerTimestamps timestamps;
+        if (stamp &&
+            recv(sock_fd, &timestamps, sizeof(timestamps), MSG_WAITALL) != sizeof(timestamps)) {
+            if (log_output) {
+                std::cerr << "Failed to receive server timestamps: " << strerror(errno) << std::endl;
+            }
             return false;
         }
 
         // Receive response data
-        std::vector<uint8_t> data;
-        if (response.actual_bytes > 0) {
-            data.resize(response.actual_bytes);
-            size_t total_received = 0;
-            while (total_received < response.actual_bytes) {
-                bytes_received = recv(sock_fd, data.data() + total_received, 
-                                    response.actual_bytes - total_received, 0);
-                if (bytes_received <= 0) {
-                    if (log_output) {
-                        std::cerr << "Failed to receive response data: " << strerror(errno) << std::endl;
-                    }
-                    close(sock_fd);
-                    return false;
-                }
-                total_received += bytes_received;
+        data.resize(response.actual_bytes);
+        size_t total_received = 0;
+        while (total_received < response.actual_bytes) {
+            bytes_received = recv(sock_fd, data.data() + total_received,
+                                  response.actual_bytes - total_received, 0);
+            if (bytes_received <= 0) {
+                if (log_output) {
+                    std::cerr << "Failed to receive response data: " << strerror(errno) << std::endl;
+                }
+                return false;
             }
+            total_received += bytes_received;
         }
 
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+        RANDOMBYTES_PROBE(response_received, sock_fd, response.actual_bytes);
+        if (stamp) {
+            latency_split_.Add(send_ns, timestamps.receive_ns, timestamps.send_ns,
+                               clock_ns(CLOCK_MONOTONIC));
+        }
+        *actual_bytes = response.actual_bytes;
+        return true;
+    }
 
-        close(sock_fd);
+public:
+    SocketRandomBytesClient(const std::string& socket_path,
+                            ConnectionMode mode = ConnectionMode::kConnectPerCall,
+                            size_t pool_size = 0)
+        : socket_path_(socket_path), mode_(mode) {
+        if (mode_ == ConnectionMode::kPool) {
+            pool_.reset(new ConnectionPool(socket_path_, pool_size));
+        }
+    }
+
+    // Ask the server to stamp each response so round trips can be split
+    // into request path, service and response path, with room for calls
+    void EnableTimestamps(size_t calls) {
+        timestamps_ = true;
+        latency_split_.Reserve(calls);
+    }
+
+    const LatencySplitStats& latency_split() const {
+        return latency_split_;
+    }
+
+    ~SocketRandomBytesClient() {
+        if (persistent_fd_ >= 0) {
+            close(persistent_fd_);
+        }
+    }
+
+    // Fetch the server's cumulative CPU usage over a separate connection, so
+    // it works in every connection mode
+    bool GetServerCpuUsage(CpuUsage* usage) {
+        return Control(CONTROL_CPU_USAGE, usage, sizeof(*usage), "CPU usage");
+    }
+
+    // Fetch the server's scheduler statistics, summed over its threads
+    bool GetServerSchedStat(SchedStat* sched) {
+        return Control(CONTROL_SCHED_STAT, sched, sizeof(*sched), "scheduler statistics");
+    }
+
+    // Request random bytes from the server
+    bool GetRandomBytes(uint32_t num_bytes, bool log_output) {
+        std::vector<uint8_t> data;
+        uint32_t actual_bytes = 0;
+
+        // The timed section covers obtaining a connection as well, so the
+        // modes differ exactly in what connection setup the caller pays for
+        uint64_t start_time = BenchClock::Now();
+
+        int sock_fd = -1;
+        switch (mode_) {
+            case ConnectionMode::kConnectPerCall:
+                sock_fd = connect_to_server(socket_path_, log_output);
+                break;
+            case ConnectionMode::kPersistent:
+                if (persistent_fd_ < 0) {
+                    persistent_fd_ = connect_to_server(socket_path_, log_output);
+                }
+                sock_fd = persistent_fd_;
+                break;
+            case ConnectionMode::kPool:
+                sock_fd = pool_->Acquire();
+                if (sock_fd < 0 && log_output) {
+                    std::cerr << "Connection pool could not connect to server" << std::endl;
+                }
+                break;
+        }
+        if (sock_fd < 0) {
+            return false;
+        }
+
+        bool ok = Exchange(sock_fd, num_bytes, data, &actual_bytes, log_output);
+
+        uint64_t duration_ns = BenchClock::ToNs(BenchClock::Now() - start_time);
+
+        if (mode_ != ConnectionMode::kPersistent) {
+            close(sock_fd);
+        } else if (!ok) {
+            // Reconnect on the next call rather than reusing a broken stream
+            close(persistent_fd_);
+            persistent_fd_ = -1;
+        }
+
+        if (!ok) {
+            return false;
+        }
 
         if (log_output) {
-            std::cout << "Received " << response.actual_bytes << " bytes in " 
-                      << duration.count() << " μs";
+            std::cout << "Received " << actual_bytes << " bytes in "
+                      << duration_ns << " ns";
             
             // Print first few bytes if requested small amount
-            if (response.actual_bytes <= 32 && response.actual_bytes > 0) {
+            if (actual_bytes <= 32 && actual_bytes > 0) {
                 std::cout << " [";
-                for (size_t i = 0; i < std::min(static_cast<size_t>(response.actual_bytes), size_t(8)); ++i) {
+                for (size_t i = 0; i < std::min(static_cast<size_t>(actual_bytes), size_t(8)); ++i) {
                     if (i > 0) std::cout << " ";
                     std::cout << std::hex << static_cast<int>(data[i]);
                 }
-                if (response.actual_bytes > 8) {
+                if (actual_bytes > 8) {
                     std::cout << " ...";
                 }
                 std::cout << "]" << std::dec;
@@ -144,15 +359,42 @@ void print_usage(const char *program_name) {
     printf("  -l, --log               Log output to stdout (default: enabled)\n");
     printf("  -q, --quiet             Disable logging to stdout\n");
     printf("  -s, --socket PATH       Socket path (default: %s)\n", SOCKET_PATH);
+    printf("  -m, --mode MODE         Connection mode: connect, persistent or pool (default: connect)\n");
+    printf("  -p, --pool-size NUM     Pre-connected sockets kept ready in pool mode (default: 8)\n");
+    printf("  -S, --startup-fd FD     Write startup phase timestamps to FD after the first call\n");
+    printf("  -P, --perf              Report hardware/software perf counters per call\n");
+    printf("  -C, --cpu-stats         Report client and server CPU time per call and per MB\n");
+    printf("  -o, --output FILE       Append a result record with latency percentiles and run\n");
+    printf("                          metadata to FILE (CSV if it ends in .csv, else JSON lines)\n");
+    printf("  -L, --label TEXT        Label stored in the result record, e.g. epoch=3\n");
+    printf("  -T, --trace-file FILE   Record every call's start, latency and status in a binary\n");
+    printf("                          trace (read with tools/trace_reader)\n");
+    printf("  -D, --sched-stats       Report client and server run time and run-queue wait per call\n");
+    printf("  -O, --one-way           Split round trips into request path, service and response\n");
+    printf("                          path using server timestamps\n");
+    printf("  -W, --warmup NUM        Untimed warm-up calls before the first epoch (default: 0)\n");
+    printf("  -V, --steady-cv PCT     After warm-up, keep warming up in batches until the mean\n");
+    printf("                          call time of the last 5 batches varies by at most PCT%%\n");
+    printf("  -E, --epochs NUM        Measured epochs of -n calls each in this process (default: 1)\n");
+    printf("  -A, --cpu LIST          Pin the client to CPUs in LIST, e.g. 2 or 0-3,8\n");
+    printf("  -w, --workload SPEC     Draw request sizes from a distribution instead of -b:\n");
+    printf("                          SIZE:WEIGHT,..., loguniform:MIN:MAX or zipf:S:SIZE,...\n");
+    printf("  -R, --replay FILE       Replay a request trace (offset_ns,bytes,client CSV) with its\n");
+    printf("                          original pacing instead of making -n calls\n");
+    printf("  -j, --threads NUM       Replay threads (default: one per client id in the trace, 1 with -r)\n");
+    printf("  -r, --rate RPS          Open loop: issue -n requests at RPS per second (Poisson arrivals)\n");
+    printf("                          and measure latency from each request's scheduled time\n");
     printf("  -h, --help              Show this help message\n");
 }
 
 int main(int argc, char** argv) {
-    int iterations = 1;
-    int bytes = 10;
+    uint64_t main_ns = startup_monotonic_ns();
+    ClientOptions options;
     int timeout_ms = 0; // Note: timeout not implemented for sockets in this simple version
-    bool log_output = true;
     std::string socket_path = SOCKET_PATH;
+    ConnectionMode mode = ConnectionMode::kConnectPerCall;
+    std::string mode_name = "connect";
+    int pool_size = 8;
     
     static struct option long_options[] = {
         {"iterations", required_argument, 0, 'n'},
@@ -161,6 +403,24 @@ int main(int argc, char** argv) {
         {"log", no_argument, 0, 'l'},
         {"quiet", no_argument, 0, 'q'},
         {"socket", required_argument, 0, 's'},
+        {"mode", required_argument, 0, 'm'},
+        {"pool-size", required_argument, 0, 'p'},
+        {"startup-fd", required_argument, 0, 'S'},
+        {"perf", no_argument, 0, 'P'},
+        {"cpu-stats", no_argument, 0, 'C'},
+        {"one-way", no_argument, 0, 'O'},
+        {"sched-stats", no_argument, 0, 'D'},
+        {"output", required_argument, 0, 'o'},
+        {"label", required_argument, 0, 'L'},
+        {"trace-file", required_argument, 0, 'T'},
+        {"warmup", required_argument, 0, 'W'},
+        {"steady-cv", required_argument, 0, 'V'},
+        {"epochs", required_argument, 0, 'E'},
+        {"cpu", required_argument, 0, 'A'},
+        {"workload", required_argument, 0, 'w'},
+        {"replay", required_argument, 0, 'R'},
+        {"threads", required_argument, 0, 'j'},
+        {"rate", required_argument, 0, 'r'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -168,21 +428,25 @@ int main(int argc, char** argv) {
     int c;
     int option_index = 0;
     
-    while ((c = getopt_long(argc, argv, "n:b:t:lqs:h", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "n:b:t:lqs:m:p:S:PCODo:L:T:W:V:E:A:w:R:j:r:h", long_options, &option_index)) != -1) {
         switch (c) {
             case 'n':
-                iterations = atoi(optarg);
-                if (iterations <= 0) {
+                options.iterations = atoi(optarg);
+                if (options.iterations <= 0) {
                     fprintf(stderr, "Error: iterations must be positive\n");
                     return 1;
                 }
                 break;
             case 'b':
-                bytes = atoi(optarg);
-                if (bytes <= 0) {
+                options.bytes = atoi(optarg);
+                if (options.bytes <= 0) {
                     fprintf(stderr, "Error: bytes must be positive\n");
                     return 1;
                 }
+                if (static_cast<uint32_t>(options.bytes) >= TIMESTAMPS_REQUEST_FLAG) {
+                    fprintf(stderr, "Error: bytes must be below 1 GiB\n");
+                    return 1;
+                }
                 break;
             case 't':
                 timeout_ms = atoi(optarg);
@@ -192,14 +456,101 @@ int main(int argc, char** argv) {
                 }
                 break;
             case 'l':
-                log_output = true;
+                options.log_output = true;
                 break;
             case 'q':
-                log_output = false;
+                options.log_output = false;
                 break;
             case 's':
                 socket_path = optarg;
                 break;
+            case 'm':
+                mode_name = optarg;
+                if (!parse_connection_mode(mode_name, &mode)) {
+                    fprintf(stderr, "Error: unknown connection mode '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'p':
+                pool_size = atoi(optarg);
+                if (pool_size <= 0) {
+                    fprintf(stderr, "Error: pool size must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'S':
+                options.startup_fd = atoi(optarg);
+                break;
+            case 'P':
+                options.perf = true;
+                break;
+            case 'C':
+                options.cpu_stats = true;
+                break;
+            case 'O':
+                options.one_way = true;
+                break;
+            case 'D':
+                options.sched_stats = true;
+                break;
+            case 'o':
+                options.output_path = optarg;
+                break;
+            case 'L':
+                options.label = optarg;
+                break;
+            case 'T':
+                options.trace_path = optarg;
+                break;
+            case 'W':
+                options.warmup = atoi(optarg);
+                if (options.warmup < 0) {
+                    fprintf(stderr, "Error: warm-up calls must be non-negative\n");
+                    return 1;
+                }
+                break;
+            case 'V':
+                options.steady_cv = atof(optarg);
+                if (options.steady_cv <= 0) {
+                    fprintf(stderr, "Error: steady-state CV must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'E':
+                options.epochs = atoi(optarg);
+                if (options.epochs <= 0) {
+                    fprintf(stderr, "Error: epochs must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'A':
+                options.cpu_list = optarg;
+                break;
+            case 'w': {
+                std::string error;
+                if (!options.workload.Parse(optarg, &error)) {
+                    fprintf(stderr, "Error: invalid workload '%s': %s\n", optarg, error.c_str());
+                    return 1;
+                }
+                break;
+            }
+            case 'R':
+                options.replay_path = optarg;
+                break;
+            case 'j':
+                options.replay_threads = atoi(optarg);
+                if (options.replay_threads <= 0) {
+                    fprintf(stderr, "Error: threads must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'r':
+                options.rate = atof(optarg);
+                if (options.rate <= 0) {
+                    fprintf(stderr, "Error: rate must be positive\n");
+                    return 1;
+                }
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -210,46 +561,61 @@ int main(int argc, char** argv) {
                 abort();
         }
     }
+
+    if (!check_replay_options(options)) {
+        return 1;
+    }
     
-    if (log_output) {
+    if (options.log_output) {
         std::cout << "Unix Socket Random Bytes Client" << std::endl;
         std::cout << "Socket: " << socket_path << std::endl;
-        std::cout << "Iterations: " << iterations << std::endl;
-        std::cout << "Bytes per call: " << bytes << std::endl;
+        print_run_plan(options);
         std::cout << "Timeout: " << (timeout_ms > 0 ? std::to_string(timeout_ms) + "ms (not implemented)" : "none") << std::endl;
+        std::cout << "Connection mode: " << mode_name;
+        if (mode == ConnectionMode::kPool) {
+            std::cout << " (" << pool_size << " sockets)";
+        }
+        std::cout << std::endl;
         std::cout << "---" << std::endl;
     }
 
-    // Create client
-    SocketRandomBytesClient client(socket_path);
+    // Before the pool's refill thread exists, so it inherits the mask
+    if (!options.cpu_list.empty() && !pin_to_cpus(options.cpu_list)) {
+        return 1;
+    }
 
-    int successful_calls = 0;
-    auto total_start = std::chrono::high_resolution_clock::now();
-    
-    // Make the specified number of calls
-    for (int i = 0; i < iterations; ++i) {
-        if (log_output && iterations > 1) {
-            std::cout << "Call " << (i + 1) << "/" << iterations << ": ";
-        }
-        
-        if (client.GetRandomBytes(bytes, log_output)) {
-            successful_calls++;
-        }
+    // Replay a request trace or an open-loop schedule instead of the fixed
+    // loop; each thread gets its own client and connection
+    if (options.replay_mode()) {
+        return run_replay_mode(options, "socket", [&]() {
+            auto caller = std::make_shared<SocketRandomBytesClient>(socket_path, mode, pool_size);
+            return [caller](uint32_t num_bytes) {
+                return caller->GetRandomBytes(num_bytes, false);
+            };
+        }, [&](ResultRecord& record) {
+            record.Add("mode", mode_name);
+            record.Add("socket", socket_path);
+        });
     }
-    
-    auto total_end = std::chrono::high_resolution_clock::now();
-    auto total_duration = std::chrono::duration_cast<std::chrono::microseconds>(total_end - total_start);
-    
-    if (log_output) {
-        std::cout << "---" << std::endl;
-        std::cout << "Summary:" << std::endl;
-        std::cout << "Successful calls: " << successful_calls << "/" << iterations << std::endl;
-        std::cout << "Total time: " << total_duration.count() << " μs" << std::endl;
-        if (iterations > 1) {
-            std::cout << "Average time per call: " << (total_duration.count() / iterations) << " μs" << std::endl;
-        }
-        std::cout << "Success rate: " << (100.0 * successful_calls / iterations) << "%" << std::endl;
+
+    // Create client
+    StartupReport startup(options.startup_fd);
+    startup.Mark("main", main_ns);
+
+    // The pool refills from its own thread, so count the whole process then
+    PerfCounters perf_counters;
+    if (options.perf) {
+        perf_counters.Open(mode == ConnectionMode::kPool ? PerfCounters::kProcess : PerfCounters::kThread);
     }
 
-    return (successful_calls == iterations) ? 0 : 1;
-}
\ No newline at end of file
+    SocketRandomBytesClient client(socket_path, mode, pool_size);
+    startup.Mark("transport");
+
+    return run_closed_loop(options, "socket", client, [&](uint32_t num_bytes, bool log) {
+        return client.GetRandomBytes(num_bytes, log);
+    }, startup, perf_counters, [&](ResultRecord& record) {
+        record.Add("mode", mode_name);
+        record.Add("pool_size", static_cast<uint64_t>(mode == ConnectionMode::kPool ? pool_size : 0));
+        record.Add("socket", socket_path);
+    });
+}
@@ -0,0 +1,120 @@
+/*
+ * Unix Domain Socket Idle Connection Holder
+ * Opens a configurable number of persistent connections to the server and
+ * keeps them idle until interrupted, for C10K-style scalability measurements
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+
+const char* SOCKET_PATH = "/tmp/randombytes_socket";
+volatile sig_atomic_t running = 1;
+
+void signal_handler(int sig) {
+    running = 0;
+}
+
+void print_usage(const char *program_name) {
+    printf("Usage: %s [OPTIONS]\n", program_name);
+    printf("Options:\n");
+    printf("  -c, --connections NUM   Number of idle connections to hold (default: 10000)\n");
+    printf("  -s, --socket PATH       Socket path (default: %s)\n", SOCKET_PATH);
+    printf("  -h, --help              Show this help message\n");
+}
+
+int main(int argc, char** argv) {
+    long num_connections = 10000;
+    std::string socket_path = SOCKET_PATH;
+
+    static struct option long_options[] = {
+        {"connections", required_argument, 0, 'c'},
+        {"socket", required_argument, 0, 's'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "c:s:h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'c':
+                num_connections = atol(optarg);
+                if (num_connections < 0) {
+                    fprintf(stderr, "Error: connections must be non-negative\n");
+                    return 1;
+                }
+                break;
+            case 's':
+                socket_path = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            case '?':
+                print_usage(argv[0]);
+                return 1;
+            default:
+                abort();
+        }
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    // Every held connection costs one descriptor in this process
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur != RLIM_INFINITY &&
+            static_cast<rlim_t>(num_connections) + 16 > limit.rlim_cur) {
+            fprintf(stderr, "Error: open file limit %lu is too low for %ld connections\n",
+                    static_cast<unsigned long>(limit.rlim_cur), num_connections);
+            return 1;
+        }
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    std::vector<int> fds;
+    fds.reserve(num_connections);
+    for (long i = 0; i < num_connections && running; ++i) {
+        int sock_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sock_fd < 0) {
+            std::cerr << "Failed to create socket " << i << ": " << strerror(errno) << std::endl;
+            break;
+        }
+        if (connect(sock_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            std::cerr << "Failed to connect socket " << i << ": " << strerror(errno) << std::endl;
+            close(sock_fd);
+            break;
+        }
+        fds.push_back(sock_fd);
+    }
+
+    // benchmark scripts wait for this line before measuring
+    std::cout << "Holding " << fds.size() << " idle connections" << std::endl;
+
+    while (running) {
+        pause();
+    }
+
+    for (int sock_fd : fds) {
+        close(sock_fd);
+    }
+
+    return fds.size() == static_cast<size_t>(num_connections) ? 0 : 1;
+}
@@ -0,0 +1,38 @@
+/*
+ * Unix Domain Socket Random Bytes Protocol
+ * Wire format shared by socket_server and socket_client
+ */
+
+#pragma once
+
+#include <cstdint>
+
+struct RandomBytesRequest {
+    uint32_t num_bytes;
+};
+
+struct RandomBytesResponse {
+    uint32_t actual_bytes;
+    // followed by actual_bytes of data
+};
+
+// Requests with this bit set in num_bytes are control requests and the low
+// bits select the operation. Data requests stay below 1 GiB. The
+// response uses the normal framing, with the control reply as its data.
+const uint32_t CONTROL_REQUEST_FLAG = 0x80000000u;
+
+// Data requests with this bit set in num_bytes ask the server to stamp the
+// response: the header is followed by ServerTimestamps, then the data.
+const uint32_t TIMESTAMPS_REQUEST_FLAG = 0x40000000u;
+
+// CLOCK_MONOTONIC ns, comparable with the client's clock on the same host
+struct ServerTimestamps {
+    uint64_t receive_ns;  // request read
+    uint64_t send_ns;     // just before the response header is sent
+};
+
+enum ControlOp : uint32_t {
+    CONTROL_CPU_USAGE = 1,    // reply: CpuUsage of the server process
+    CONTROL_PHASE_STATS = 2,  // reply: text table of per-phase timings
+    CONTROL_SCHED_STAT = 3,   // reply: SchedStat summed over the server's threads
+};
@@ -8,48 +8,138 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <sys/random.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <signal.h>
+#include <time.h>
 #include <cstring>
 #include <cerrno>
 
-// Protocol definition
-struct RandomBytesRequest {
-    uint32_t num_bytes;
+#include "cpu_affinity.h"
+#include "cpu_usage.h"
+#include "metrics.h"
+#include "perf_counters.h"
+#include "probes.h"
+#include "readiness.h"
+#include "schedstat.h"
+#include "server_stats.h"
+#include "socket_protocol.h"
+
+const char* SOCKET_PATH = "/tmp/randombytes_socket";
+volatile sig_atomic_t running = 1;
+volatile sig_atomic_t dump_stats = 0;
+ServerMetrics metrics;
+
+// Connection gauges the event loop publishes once per wake-up for the
+// metrics thread
+std::atomic<uint64_t> published_connections{0};
+std::atomic<uint64_t> published_accepted{0};
+// Connections with a request being read or a response being written, the
+// server's queue depth; kept up to date by the event loop
+std::atomic<int64_t> inflight_requests{0};
+
+// Responses larger than this are not kept around between requests, so a
+// single bulk pull does not pin megabytes to an otherwise idle connection
+const size_t MAX_RETAINED_BUFFER = 64 * 1024;
+
+// Per-connection state. Client sockets are non-blocking: a request header
+// or response that does not fit in one read or write is resumed on the next
+// readiness event, so a slow or stalled client never holds up the others.
+// The response buffer is only allocated when the connection sends a
+// request, so an idle connection costs no more than this struct and its map
+// entry.
+struct Connection {
+    RandomBytesRequest request;
+    size_t request_read = 0;       // bytes of the request header received
+    std::vector<uint8_t> buffer;   // response header, timestamps, then data
+    size_t response_sent = 0;      // bytes of buffer already sent
+    bool writing = false;          // a response is (partly) unsent
+    bool polling_out = false;      // registered for EPOLLOUT instead of EPOLLIN
+    bool control = false;
+    bool stamp = false;
+    uint32_t num_bytes = 0;
+    uint64_t read_start = 0;
+    uint64_t read_end = 0;
+    uint64_t entropy_end = 0;
 };
 
-struct RandomBytesResponse {
-    uint32_t actual_bytes;
-    // followed by actual_bytes of data
+// Outcome of servicing a ready connection
+enum ServeResult {
+    SERVE_CLOSE,     // error or client closed, drop the connection
+    SERVE_PENDING,   // waiting for the rest of the request or room to send
+    SERVE_DONE,      // the response to a data request went out completely
+    SERVE_CONTROL,   // the response to a control request went out completely
 };
 
-const char* SOCKET_PATH = "/tmp/randombytes_socket";
-volatile sig_atomic_t running = 1;
+// Event loop counters, printed on shutdown
+struct EventLoopStats {
+    uint64_t wakeups = 0;        // epoll_wait() calls that returned events
+    uint64_t events = 0;         // events dispatched
+    uint64_t dispatch_ns = 0;    // time spent handling events after wake-up
+    uint64_t accepted = 0;
+    uint64_t requests = 0;       // data requests served, control requests excluded
+    size_t peak_connections = 0;
+};
 
 void signal_handler(int sig) {
     running = 0;
 }
 
+void dump_stats_handler(int sig) {
+    dump_stats = 1;
+}
+
 void print_usage(const char *program_name) {
     printf("Usage: %s [OPTIONS]\n", program_name);
     printf("Options:\n");
     printf("  -s, --socket PATH       Socket path (default: %s)\n", SOCKET_PATH);
+    printf("  -r, --hot-restart       Take over the listening socket from a running server\n");
+    printf("                          started with -r, and accept handoffs from the next one\n");
+    printf("  -c, --handoff-connections\n");
+    printf("                          With -r, also take over the old server's connections\n");
+    printf("  -d, --drain-timeout SEC Time to keep serving old connections after a handoff (default: 30)\n");
+    printf("  -f, --ready-fd FD       Write READY=1 to FD once listening (also honours NOTIFY_SOCKET)\n");
+    printf("  -P, --perf              Count perf events and report them per request on shutdown\n");
+    printf("  -M, --metrics ADDR      Serve Prometheus metrics on a Unix socket path, HOST:PORT\n");
+    printf("                          or a port on 127.0.0.1\n");
+    printf("  -A, --cpu LIST          Pin the server to CPUs in LIST, e.g. 2 or 0-3,8\n");
     printf("  -h, --help              Show this help message\n");
+    printf("\n");
+    printf("Per-phase timings are printed on SIGUSR1 and on shutdown.\n");
+}
+
+// Raise the open file limit to the hard limit so the server can hold tens of
+// thousands of idle connections
+void raise_fd_limit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &limit) < 0) {
+            std::cerr << "Failed to raise open file limit: " << strerror(errno) << std::endl;
+        }
+    }
 }
 
 // Generate random bytes using getrandom syscall
-bool generate_random_bytes(std::vector<uint8_t>& buffer, size_t num_bytes) {
+bool generate_random_bytes(uint8_t* data, size_t num_bytes) {
     if (num_bytes == 0) {
         return true;
     }
     
-    buffer.resize(num_bytes);
-    
-    ssize_t result = getrandom(buffer.data(), num_bytes, 0);
+    uint64_t start = phase_clock_ns();
+    ssize_t result = getrandom(data, num_bytes, 0);
+    metrics.RecordGetrandom(num_bytes, phase_clock_ns() - start,
+                            static_cast<size_t>(result) == num_bytes);
     if (result < 0) {
         std::cerr << "getrandom failed: " << strerror(errno) << std::endl;
         return false;
@@ -64,67 +154,435 @@ bool generate_random_bytes(std::vector<uint8_t>& buffer, size_t num_bytes) {
     return true;
 }
 
-bool handle_client(int client_fd) {
-    RandomBytesRequest request;
+// Lay out a response in conn.buffer: the header, room for timestamps if
+// requested, then num_bytes of data. Returns where the data goes.
+uint8_t* start_response(Connection& conn, uint32_t num_bytes, bool stamp) {
+    size_t header_size = sizeof(RandomBytesResponse) + (stamp ? sizeof(ServerTimestamps) : 0);
+    conn.buffer.resize(header_size + num_bytes);
     
-    // Read request
-    ssize_t bytes_read = recv(client_fd, &request, sizeof(request), 0);
-    if (bytes_read != sizeof(request)) {
-        std::cerr << "Failed to read request: " << strerror(errno) << std::endl;
-        return false;
+    RandomBytesResponse response;
+    response.actual_bytes = num_bytes;
+    memcpy(conn.buffer.data(), &response, sizeof(response));
+
+    conn.stamp = stamp;
+    conn.response_sent = 0;
+    conn.writing = true;
+    return conn.buffer.data() + header_size;
+}
+
+// Send as much of the pending response as the socket takes. With timestamps,
+// send_ns is stamped just before the first byte goes out. conn.writing
+// stays set while part of the response is left.
+bool send_response(int client_fd, Connection& conn) {
+    if (conn.response_sent == 0 && conn.stamp) {
+        ServerTimestamps timestamps;
+        timestamps.receive_ns = conn.read_end;
+        timestamps.send_ns = phase_clock_ns();
+        memcpy(conn.buffer.data() + sizeof(RandomBytesResponse), &timestamps, sizeof(timestamps));
+    }
+
+    while (conn.response_sent < conn.buffer.size()) {
+        ssize_t bytes_sent = send(client_fd, conn.buffer.data() + conn.response_sent,
+                                  conn.buffer.size() - conn.response_sent, MSG_NOSIGNAL);
+        if (bytes_sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true; // Socket buffer full, resume on EPOLLOUT
+        }
+        if (bytes_sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_sent <= 0) {
+            std::cerr << "Failed to send response: " << strerror(errno) << std::endl;
+            return false;
+        }
+        conn.response_sent += bytes_sent;
+    }
+
+    conn.writing = false;
+    return true;
+}
+
+// Answer a control request, see socket_protocol.h
+bool handle_control_request(Connection& conn, uint32_t op) {
+    switch (op) {
+        case CONTROL_CPU_USAGE: {
+            CpuUsage usage = read_cpu_usage();
+            memcpy(start_response(conn, sizeof(usage), false), &usage, sizeof(usage));
+            return true;
+        }
+        case CONTROL_SCHED_STAT: {
+            SchedStat sched;
+            read_sched_stat(&sched);
+            memcpy(start_response(conn, sizeof(sched), false), &sched, sizeof(sched));
+            return true;
+        }
+        case CONTROL_PHASE_STATS: {
+            std::string text = format_phase_stats(thread_phase_stats());
+            memcpy(start_response(conn, text.size(), false), text.data(), text.size());
+            return true;
+        }
+        default:
+            std::cerr << "Unknown control request: " << op << std::endl;
+            return false;
     }
+}
+
+// A complete request header has arrived: generate the response into
+// conn.buffer
+bool start_request(int client_fd, Connection& conn) {
+    conn.control = (conn.request.num_bytes & CONTROL_REQUEST_FLAG) != 0;
+    if (conn.control) {
+        return handle_control_request(conn, conn.request.num_bytes & ~CONTROL_REQUEST_FLAG);
+    }
+    conn.read_end = phase_clock_ns();
+    bool stamp = (conn.request.num_bytes & TIMESTAMPS_REQUEST_FLAG) != 0;
+    conn.num_bytes = conn.request.num_bytes & ~TIMESTAMPS_REQUEST_FLAG;
+    RANDOMBYTES_PROBE(request_start, client_fd, conn.num_bytes);
     
     // Validate request - no size limits imposed
     
     // Generate random bytes
-    std::vector<uint8_t> random_data;
-    if (!generate_random_bytes(random_data, request.num_bytes)) {
+    uint8_t* random_data = start_response(conn, conn.num_bytes, stamp);
+    if (!generate_random_bytes(random_data, conn.num_bytes)) {
+        return false;
+    }
+    conn.entropy_end = phase_clock_ns();
+    RANDOMBYTES_PROBE(entropy_generated, client_fd, conn.num_bytes);
+    return true;
+}
+
+// The last byte of a response went out
+void finish_request(int client_fd, Connection& conn) {
+    inflight_requests.fetch_sub(1, std::memory_order_relaxed);
+    if (!conn.control) {
+        uint64_t write_end = phase_clock_ns();
+        RANDOMBYTES_PROBE(response_sent, client_fd, conn.num_bytes);
+
+        ServerPhaseStats& phase_stats = thread_phase_stats();
+        phase_stats.Record(PHASE_READ, conn.read_start, conn.read_end);
+        phase_stats.Record(PHASE_ENTROPY, conn.read_end, conn.entropy_end);
+        phase_stats.Record(PHASE_WRITE, conn.entropy_end, write_end);
+        phase_stats.Record(PHASE_SERVICE, conn.read_start, write_end);
+        metrics.RecordRequest(conn.num_bytes, write_end - conn.read_start);
+    }
+
+    if (conn.buffer.capacity() > MAX_RETAINED_BUFFER) {
+        std::vector<uint8_t>().swap(conn.buffer);
+    }
+}
+
+// Make progress on the connection's current request: read the rest of its
+// header, generate the response and send as much of it as the socket takes
+ServeResult serve_connection(int client_fd, Connection& conn) {
+    if (!conn.writing) {
+        if (conn.request_read == 0) {
+            conn.read_start = phase_clock_ns();
+        }
+
+        // Read request
+        ssize_t bytes_read = recv(client_fd, reinterpret_cast<uint8_t*>(&conn.request) + conn.request_read,
+                                  sizeof(conn.request) - conn.request_read, 0);
+        if (bytes_read == 0) {
+            return SERVE_CLOSE; // Client closed the connection
+        }
+        if (bytes_read < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return SERVE_PENDING;
+            }
+            std::cerr << "Failed to read request: " << strerror(errno) << std::endl;
+            return SERVE_CLOSE;
+        }
+        if (conn.request_read == 0) {
+            inflight_requests.fetch_add(1, std::memory_order_relaxed);
+        }
+        conn.request_read += bytes_read;
+        if (conn.request_read < sizeof(conn.request)) {
+            return SERVE_PENDING;
+        }
+        conn.request_read = 0;
+
+        if (!start_request(client_fd, conn)) {
+            return SERVE_CLOSE;
+        }
+    }
+
+    if (!send_response(client_fd, conn)) {
+        return SERVE_CLOSE;
+    }
+    if (conn.writing) {
+        return SERVE_PENDING;
+    }
+    finish_request(client_fd, conn);
+    return conn.control ? SERVE_CONTROL : SERVE_DONE;
+}
+
+// Hot restart handoff protocol. A new server connects to the handoff socket
+// of the running one and sends a HandoffRequest; the old server replies with
+// HandoffMessages carrying file descriptors via SCM_RIGHTS: first the
+// listening socket, then optionally its connections in batches, then a
+// message of kind HANDOFF_DONE.
+struct HandoffRequest {
+    uint32_t want_connections;
+};
+
+enum HandoffKind : uint32_t {
+    HANDOFF_LISTENER = 1,
+    HANDOFF_CONNECTIONS = 2,
+    HANDOFF_DONE = 3,
+};
+
+struct HandoffMessage {
+    uint32_t kind;
+    uint32_t num_fds;
+};
+
+// Kernel limit on descriptors per SCM_RIGHTS message is 253
+const size_t MAX_FDS_PER_MESSAGE = 250;
+
+std::string handoff_path_for(const std::string& socket_path) {
+    return socket_path + ".handoff";
+}
+
+bool send_fds(int sock_fd, uint32_t kind, const int* fds, size_t num_fds) {
+    HandoffMessage message;
+    message.kind = kind;
+    message.num_fds = static_cast<uint32_t>(num_fds);
+
+    struct iovec iov;
+    iov.iov_base = &message;
+    iov.iov_len = sizeof(message);
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * MAX_FDS_PER_MESSAGE));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (num_fds > 0) {
+        msg.msg_control = control.data();
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * num_fds);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * num_fds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * num_fds);
+    }
+
+    if (sendmsg(sock_fd, &msg, 0) != sizeof(message)) {
+        std::cerr << "Failed to send handoff message: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool recv_fds(int sock_fd, HandoffMessage* message, std::vector<int>& fds) {
+    struct iovec iov;
+    iov.iov_base = message;
+    iov.iov_len = sizeof(*message);
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * MAX_FDS_PER_MESSAGE));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    if (recvmsg(sock_fd, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC) != sizeof(*message)) {
+        std::cerr << "Failed to receive handoff message: " << strerror(errno) << std::endl;
         return false;
     }
     
-    // Send response header
-    RandomBytesResponse response;
-    response.actual_bytes = request.num_bytes;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int* received = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+            fds.insert(fds.end(), received, received + count);
+        }
+    }
+    return true;
+}
+    
+// Create a Unix socket bound to path and listening; returns -1 on failure
+int create_listening_socket(const std::string& path, int flags) {
+    int sock_fd = socket(AF_UNIX, SOCK_STREAM | flags, 0);
+    if (sock_fd < 0) {
+        std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
+        return -1;
+    }
+
+    // Remove existing socket file if it exists
+    unlink(path.c_str());
+
+    // Bind socket
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (bind(sock_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::cerr << "Failed to bind socket: " << strerror(errno) << std::endl;
+        close(sock_fd);
+        return -1;
+    }
+
+    // Listen for connections
+    // Pooled clients keep several connections queued before they are accepted
+    if (listen(sock_fd, SOMAXCONN) < 0) {
+        std::cerr << "Failed to listen: " << strerror(errno) << std::endl;
+        close(sock_fd);
+        unlink(path.c_str());
+        return -1;
+    }
+
+    return sock_fd;
+}
+
+// Ask a running server for its listening socket (and optionally its
+// connections). Returns false if no server is accepting handoffs.
+bool take_over(const std::string& handoff_path, bool want_connections,
+               int* listen_fd, std::vector<int>& connection_fds) {
+    int sock_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock_fd < 0) {
+        return false;
+    }
     
-    ssize_t bytes_sent = send(client_fd, &response, sizeof(response), 0);
-    if (bytes_sent != sizeof(response)) {
-        std::cerr << "Failed to send response header: " << strerror(errno) << std::endl;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, handoff_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (connect(sock_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock_fd);
         return false;
     }
+
+    HandoffRequest request;
+    request.want_connections = want_connections ? 1 : 0;
+    if (send(sock_fd, &request, sizeof(request), 0) != sizeof(request)) {
+        close(sock_fd);
+        return false;
+    }
+
+    *listen_fd = -1;
+    while (true) {
+        HandoffMessage message;
+        std::vector<int> fds;
+        if (!recv_fds(sock_fd, &message, fds)) {
+            break;
+        }
+        if (message.kind == HANDOFF_DONE) {
+            close(sock_fd);
+            return *listen_fd >= 0;
+        }
+        if (message.kind == HANDOFF_LISTENER && fds.size() == 1) {
+            *listen_fd = fds[0];
+        } else {
+            connection_fds.insert(connection_fds.end(), fds.begin(), fds.end());
+        }
+    }
     
-    // Send response data
-    if (request.num_bytes > 0) {
-        size_t total_sent = 0;
-        while (total_sent < request.num_bytes) {
-            bytes_sent = send(client_fd, random_data.data() + total_sent, 
-                            request.num_bytes - total_sent, 0);
-            if (bytes_sent <= 0) {
-                std::cerr << "Failed to send response data: " << strerror(errno) << std::endl;
-                return false;
+    // Incomplete handoff: keep whatever was received, the old server has
+    // already stopped accepting
+    close(sock_fd);
+    return *listen_fd >= 0;
+}
+
+// Give the listening socket (and optionally all connections) to a new server
+// that connected to the handoff socket and sent request. The socket is
+// non-blocking, so a successor that stops reading fails the handoff instead
+// of stalling the event loop.
+bool hand_over(int handoff_fd, const HandoffRequest& request, int listen_fd,
+               const std::vector<int>& connection_fds, bool* connections_sent) {
+    if (!send_fds(handoff_fd, HANDOFF_LISTENER, &listen_fd, 1)) {
+        return false;
+    }
+
+    *connections_sent = false;
+    if (request.want_connections) {
+        for (size_t i = 0; i < connection_fds.size(); i += MAX_FDS_PER_MESSAGE) {
+            size_t count = std::min(MAX_FDS_PER_MESSAGE, connection_fds.size() - i);
+            if (!send_fds(handoff_fd, HANDOFF_CONNECTIONS, connection_fds.data() + i, count)) {
+                return true; // The listener already moved, drain the rest
             }
-            total_sent += bytes_sent;
         }
+        *connections_sent = true;
     }
-    
+
+    send_fds(handoff_fd, HANDOFF_DONE, NULL, 0);
     return true;
 }
 
+bool epoll_add(int epoll_fd, int fd, uint32_t events) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+bool epoll_modify(int epoll_fd, int fd, uint32_t events) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
 int main(int argc, char *argv[]) {
     std::string socket_path = SOCKET_PATH;
+    bool hot_restart = false;
+    bool handoff_connections = false;
+    int drain_timeout_s = 30;
+    int ready_fd = -1;
+    bool perf = false;
+    std::string metrics_address;
+    std::string cpu_list;
     
     // Command line option parsing
     static struct option long_options[] = {
         {"socket", required_argument, 0, 's'},
+        {"hot-restart", no_argument, 0, 'r'},
+        {"handoff-connections", no_argument, 0, 'c'},
+        {"drain-timeout", required_argument, 0, 'd'},
+        {"ready-fd", required_argument, 0, 'f'},
+        {"perf", no_argument, 0, 'P'},
+        {"metrics", required_argument, 0, 'M'},
+        {"cpu", required_argument, 0, 'A'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     
     int c;
-    while ((c = getopt_long(argc, argv, "s:h", long_options, NULL)) != -1) {
+    while ((c = getopt_long(argc, argv, "s:rcd:f:PM:A:h", long_options, NULL)) != -1) {
         switch (c) {
             case 's':
                 socket_path = optarg;
                 break;
+            case 'r':
+                hot_restart = true;
+                break;
+            case 'c':
+                handoff_connections = true;
+                break;
+            case 'd':
+                drain_timeout_s = atoi(optarg);
+                if (drain_timeout_s < 0) {
+                    fprintf(stderr, "Error: drain timeout must be non-negative\n");
+                    return 1;
+                }
+                break;
+            case 'f':
+                ready_fd = atoi(optarg);
+                break;
+            case 'P':
+                perf = true;
+                break;
+            case 'M':
+                metrics_address = optarg;
+                break;
+            case 'A':
+                cpu_list = optarg;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -136,84 +594,358 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    if (!cpu_list.empty() && !pin_to_cpus(cpu_list)) {
+        return 1;
+    }
+
     // Set up signal handler
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, dump_stats_handler);
+    // A client vanishing mid-response must not kill the server, even for
+    // writes other than send(MSG_NOSIGNAL)
+    signal(SIGPIPE, SIG_IGN);
     
-    // Create socket
-    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (server_fd < 0) {
-        std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
-        return 1;
+    raise_fd_limit();
+
+    // All sockets are non-blocking: every pending connection is accepted per
+    // wake-up, and client I/O never waits inside the loop. With hot
+    // restart, the socket is taken over from a running server if there is
+    // one, so the path is never unbound while clients connect.
+    std::string handoff_path = handoff_path_for(socket_path);
+    std::vector<int> inherited_connections;
+    int server_fd = -1;
+    bool took_over = hot_restart &&
+        take_over(handoff_path, handoff_connections, &server_fd, inherited_connections);
+    if (took_over) {
+        int flags = fcntl(server_fd, F_GETFL);
+        fcntl(server_fd, F_SETFL, flags | O_NONBLOCK);
+    } else {
+        server_fd = create_listening_socket(socket_path, SOCK_NONBLOCK);
+        if (server_fd < 0) {
+            return 1;
+        }
     }
     
-    // Remove existing socket file if it exists
-    unlink(socket_path.c_str());
-    
-    // Bind socket
-    struct sockaddr_un addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    // The previous server has closed its handoff socket by now, so the path
+    // can be rebound for the next restart
+    int handoff_fd = -1;
+    if (hot_restart) {
+        handoff_fd = create_listening_socket(handoff_path, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (handoff_fd < 0) {
+            close(server_fd);
+            return 1;
+        }
+    }
     
-    if (bind(server_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        std::cerr << "Failed to bind socket: " << strerror(errno) << std::endl;
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+        std::cerr << "Failed to create epoll instance: " << strerror(errno) << std::endl;
         close(server_fd);
+        unlink(socket_path.c_str());
         return 1;
     }
     
-    // Listen for connections
-    if (listen(server_fd, 10) < 0) {
-        std::cerr << "Failed to listen: " << strerror(errno) << std::endl;
+    if (!epoll_add(epoll_fd, server_fd, EPOLLIN) ||
+        (handoff_fd >= 0 && !epoll_add(epoll_fd, handoff_fd, EPOLLIN))) {
+        std::cerr << "Failed to register listening socket: " << strerror(errno) << std::endl;
+        close(epoll_fd);
         close(server_fd);
         unlink(socket_path.c_str());
         return 1;
     }
-    
+
+    // Scrapes are served one at a time on their own thread, so a slow or
+    // silent scraper never holds up the event loop. The thread blocks all
+    // signals so they keep interrupting epoll_wait() in the loop.
+    int metrics_fd = -1;
+    std::thread metrics_thread;
+    if (!metrics_address.empty()) {
+        metrics_fd = create_metrics_listener(metrics_address);
+        if (metrics_fd < 0) {
+            close(epoll_fd);
+            close(server_fd);
+            unlink(socket_path.c_str());
+            return 1;
+        }
+        sigset_t all_signals, old_signals;
+        sigfillset(&all_signals);
+        pthread_sigmask(SIG_BLOCK, &all_signals, &old_signals);
+        metrics_thread = std::thread([metrics_fd]() {
+            int scrape_fd;
+            while ((scrape_fd = accept4(metrics_fd, NULL, NULL, SOCK_CLOEXEC)) >= 0 || errno == EINTR) {
+                if (scrape_fd < 0) {
+                    continue;
+                }
+                MetricsText text;
+                metrics.Render(text);
+                text.Gauge("randombytes_connections", "Open client connections.",
+                           published_connections.load(std::memory_order_relaxed));
+                text.Counter("randombytes_connections_accepted_total", "Accepted client connections.",
+                             published_accepted.load(std::memory_order_relaxed));
+                text.Gauge("randombytes_inflight_requests",
+                           "Connections with a request being read or a response being written.",
+                           inflight_requests.load(std::memory_order_relaxed));
+                serve_metrics_client(scrape_fd, text.str());
+            }
+        });
+        pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    }
+
+    std::unordered_map<int, Connection> connections;
+    for (int fd : inherited_connections) {
+        int flags = fcntl(fd, F_GETFL);
+        if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0 && epoll_add(epoll_fd, fd, EPOLLIN | EPOLLRDHUP)) {
+            connections.emplace(fd, Connection());
+        } else {
+            close(fd);
+        }
+    }
+
+    if (took_over) {
+        std::cout << "Socket server took over: " << socket_path << " ("
+                  << connections.size() << " connections)" << std::endl;
+    }
     std::cout << "Socket server listening on: " << socket_path << std::endl;
+    notify_ready(ready_fd);
+
+    EventLoopStats stats;
+
+    // Requests are only served on this thread, so one counter group covers
+    // them; the metrics thread is left out
+    PerfCounters perf_counters;
+    if (perf) {
+        perf_counters.Open(PerfCounters::kThread);
+        perf_counters.Start();
+    }
+
+    const int MAX_EVENTS = 256;
+    struct epoll_event events[MAX_EVENTS];
+
+    // After handing the listener to a new server, keep serving existing
+    // connections until they close or the drain deadline passes
+    bool handed_off = false;
+    uint64_t drain_deadline = 0;
+    // A new server that connected for a handoff and whose request has not
+    // arrived yet
+    int handoff_peer_fd = -1;
     
     // Main server loop
     while (running) {
-        fd_set read_fds;
-        FD_ZERO(&read_fds);
-        FD_SET(server_fd, &read_fds);
+        if (handed_off && (connections.empty() || phase_clock_ns() > drain_deadline)) {
+            break;
+        }
         
-        struct timeval timeout;
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
+        uint64_t wait_start = phase_clock_ns();
+        int num_events = epoll_wait(epoll_fd, events, MAX_EVENTS, 1000);
         
-        int select_result = select(server_fd + 1, &read_fds, NULL, NULL, &timeout);
+        if (dump_stats) {
+            dump_stats = 0;
+            std::cout << format_phase_stats(thread_phase_stats()) << std::flush;
+        }
         
-        if (select_result < 0) {
+        if (num_events < 0) {
             if (errno == EINTR) {
                 continue; // Interrupted by signal
             }
-            std::cerr << "Select failed: " << strerror(errno) << std::endl;
+            std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
             break;
         }
         
-        if (select_result == 0) {
+        if (num_events == 0) {
             continue; // Timeout
         }
         
-        if (FD_ISSET(server_fd, &read_fds)) {
-            int client_fd = accept(server_fd, NULL, NULL);
-            if (client_fd < 0) {
-                std::cerr << "Failed to accept connection: " << strerror(errno) << std::endl;
+        uint64_t wake_time = phase_clock_ns();
+        thread_phase_stats().Record(PHASE_WAIT, wait_start, wake_time);
+        stats.wakeups++;
+        stats.events += num_events;
+
+        for (int i = 0; i < num_events; ++i) {
+            int fd = events[i].data.fd;
+
+            if (fd == server_fd) {
+                if (handed_off) {
+                    continue;
+                }
+                // Accept every pending connection
+                while (true) {
+                    uint64_t accept_start = phase_clock_ns();
+                    int client_fd = accept4(server_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+                    if (client_fd < 0) {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            std::cerr << "Failed to accept connection: " << strerror(errno) << std::endl;
+                        }
+                        break;
+                    }
+
+                    if (!epoll_add(epoll_fd, client_fd, EPOLLIN | EPOLLRDHUP)) {
+                        std::cerr << "Failed to register connection: " << strerror(errno) << std::endl;
+                        close(client_fd);
+                        continue;
+                    }
+
+                    connections.emplace(client_fd, Connection());
+                    stats.accepted++;
+                    thread_phase_stats().Record(PHASE_ACCEPT, accept_start, phase_clock_ns());
+                }
+                if (connections.size() > stats.peak_connections) {
+                    stats.peak_connections = connections.size();
+                }
                 continue;
             }
             
-            // Handle client request
-            handle_client(client_fd);
-            close(client_fd);
+            if (fd == handoff_fd) {
+                // The request is read once it arrives, so a successor that
+                // connects and stalls never blocks the loop. A newer one
+                // replaces it.
+                int peer_fd = accept4(handoff_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+                if (peer_fd < 0) {
+                    continue;
+                }
+                if (handoff_peer_fd >= 0) {
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, handoff_peer_fd, NULL);
+                    close(handoff_peer_fd);
+                    handoff_peer_fd = -1;
+                }
+                if (!epoll_add(epoll_fd, peer_fd, EPOLLIN)) {
+                    close(peer_fd);
+                    continue;
+                }
+                handoff_peer_fd = peer_fd;
+                continue;
+            }
+
+            if (fd == handoff_peer_fd) {
+                HandoffRequest request;
+                ssize_t bytes_read = recv(handoff_peer_fd, &request, sizeof(request), 0);
+                if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                    continue;
+                }
+                int peer_fd = handoff_peer_fd;
+                handoff_peer_fd = -1;
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, peer_fd, NULL);
+                if (bytes_read != sizeof(request)) {
+                    std::cerr << "Failed to read handoff request" << std::endl;
+                    close(peer_fd);
+                    continue;
+                }
+
+                // Stop accepting before the listener changes hands; pending
+                // connections stay queued in the shared backlog
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, server_fd, NULL);
+
+                // Only connections between requests move; one with a request
+                // or response in flight stays here and drains
+                std::vector<int> connection_fds;
+                connection_fds.reserve(connections.size());
+                for (auto& entry : connections) {
+                    if (!entry.second.writing && entry.second.request_read == 0) {
+                        connection_fds.push_back(entry.first);
+                    }
+                }
+
+                bool connections_sent = false;
+                if (!hand_over(peer_fd, request, server_fd, connection_fds, &connections_sent)) {
+                    // The new server did not get the listener, keep serving
+                    close(peer_fd);
+                    epoll_add(epoll_fd, server_fd, EPOLLIN);
+                    continue;
+                }
+
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, handoff_fd, NULL);
+                close(handoff_fd);
+                handoff_fd = -1;
+                close(peer_fd);
+
+                if (connections_sent) {
+                    // The new server owns them now, only drop our copies
+                    for (int handed_fd : connection_fds) {
+                        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, handed_fd, NULL);
+                        close(handed_fd);
+                        connections.erase(handed_fd);
+                    }
+                }
+
+                handed_off = true;
+                drain_deadline = phase_clock_ns() + drain_timeout_s * 1000000000ull;
+                std::cout << "Handed off listener, draining " << connections.size()
+                          << " connections" << std::endl;
+                break; // Remaining events may refer to closed descriptors
+            }
+
+            // Make progress on one client request per wake-up so a busy
+            // persistent connection cannot starve the others
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            Connection& conn = it->second;
+            ServeResult result = (events[i].events & (EPOLLERR | EPOLLHUP)) ? SERVE_CLOSE
+                                                                             : serve_connection(fd, conn);
+            if (result == SERVE_CLOSE) {
+                if (conn.writing || conn.request_read > 0) {
+                    inflight_requests.fetch_sub(1, std::memory_order_relaxed);
+                }
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+                close(fd);
+                connections.erase(it);
+                continue;
+            }
+            if (result == SERVE_DONE) {
+                stats.requests++;
+            }
+
+            // Wait for room to send while a response is left over, and only
+            // read the next request once it is out
+            if (conn.writing != conn.polling_out) {
+                conn.polling_out = conn.writing;
+                epoll_modify(epoll_fd, fd, (conn.writing ? EPOLLOUT : EPOLLIN) | EPOLLRDHUP);
+            }
         }
+
+        stats.dispatch_ns += phase_clock_ns() - wake_time;
+        published_connections.store(connections.size(), std::memory_order_relaxed);
+        published_accepted.store(stats.accepted, std::memory_order_relaxed);
     }
-    
+
     std::cout << "Server shutting down..." << std::endl;
-    
-    // Cleanup
+    std::cout << "Event loop: " << stats.wakeups << " wake-ups, "
+              << stats.events << " events, "
+              << (stats.wakeups > 0 ? stats.dispatch_ns / stats.wakeups : 0) << " ns per wake-up, "
+              << stats.accepted << " connections accepted, "
+              << stats.peak_connections << " peak connections" << std::endl;
+    std::cout << format_phase_stats(thread_phase_stats());
+    if (perf) {
+        perf_counters.Stop();
+        print_perf_report(stdout, "server", perf_counters, perf_counters.Read(), stats.requests);
+    }
+
+    // Cleanup. After a handoff the socket paths belong to the new server.
+    for (auto& entry : connections) {
+        close(entry.first);
+    }
+    if (handoff_peer_fd >= 0) {
+        close(handoff_peer_fd);
+    }
+    close(epoll_fd);
     close(server_fd);
-    unlink(socket_path.c_str());
+    if (metrics_fd >= 0) {
+        // Wakes up the blocked accept()
+        shutdown(metrics_fd, SHUT_RDWR);
+        metrics_thread.join();
+        close(metrics_fd);
+        if (metrics_address.find('/') != std::string::npos) {
+            unlink(metrics_address.c_str());
+        }
+    }
+    if (!handed_off) {
+        unlink(socket_path.c_str());
+        if (handoff_fd >= 0) {
+            close(handoff_fd);
+            unlink(handoff_path.c_str());
+        }
+    }
     
     return 0;
 }
\ No newline at end of file
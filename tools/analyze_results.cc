@@ -0,0 +1,806 @@
+/*
+ * Results analyzer
+ * Reads result records from all transports (JSON lines or CSV written with
+ * the clients' -o option, or the legacy "epoch bytes iterations m:ss.ss"
+ * text files) and summarises each configuration: median run time with a
+ * bootstrap confidence interval, throughput, p99 latency and outliers
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <functional>
+#include <getopt.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+// One configuration: runs with the same key are repetitions of each other
+struct ConfigKey {
+    std::string transport;
+    std::string mode;
+    uint64_t bytes = 0;
+    uint64_t iterations = 0;
+    // "wall": whole process from /usr/bin/time (legacy text files), including
+    // exec, dynamic loading and connecting. "loop": the client's timed loop
+    // only (result records). The two are never compared with each other.
+    std::string timing;
+    // Record fields that change what a run measures, when not at their
+    // defaults: "workload=...,cpu=...,replay=...,rate=..." (and "label=..."
+    // with -l). Empty for plain closed-loop fixed-size runs.
+    std::string variant;
+
+    bool operator<(const ConfigKey& other) const {
+        return std::tie(transport, mode, bytes, iterations, timing, variant) <
+               std::tie(other.transport, other.mode, other.bytes, other.iterations, other.timing,
+                        other.variant);
+    }
+};
+
+struct Run {
+    double seconds = 0;
+    double p99_ns = -1;   // -1 when the source has no latency percentiles
+};
+
+typedef std::map<ConfigKey, std::vector<Run>> ResultSet;
+
+struct ConfigSummary {
+    size_t runs = 0;
+    double median_s = 0;
+    double ci_low_s = 0;
+    double ci_high_s = 0;
+    double requests_per_s = 0;
+    double mb_per_s = 0;
+    double p99_ns = -1;
+    size_t outliers = 0;
+};
+
+void print_usage(const char *program_name) {
+    printf("Usage: %s [OPTIONS] FILE...\n", program_name);
+    printf("Options:\n");
+    printf("  -d, --data-dir DIR      Write one plot data file per transport and mode to DIR\n");
+    printf("  -r, --resamples NUM     Bootstrap resamples for the median CI (default: 2000)\n");
+    printf("  -B, --baseline FILE     Compare against baseline results in FILE (repeatable)\n");
+    printf("  -t, --threshold PCT     Smallest slowdown reported as a regression (default: 5)\n");
+    printf("  -a, --alpha P           Significance level of the regression test (default: 0.05)\n");
+    printf("  -T, --transport NAME    Transport of legacy text files (default: from the file name)\n");
+    printf("  -l, --by-label          Also group records by label (without epoch=N)\n");
+    printf("  -h, --help              Show this help message\n");
+    printf("\n");
+    printf("FILE is a client result file (.jsonl/.json or .csv, see common/results.h) or a\n");
+    printf("legacy benchmark text file; for those the transport is taken from the file name\n");
+    printf("(socket.txt, grpc_large.txt, ...) unless -T is given.\n");
+    printf("\n");
+    printf("With -B the exit status is 2 if any configuration regressed and 3 if no\n");
+    printf("configuration was found in both the baseline and the current results.\n");
+}
+
+// ---------------------------------------------------------------------------
+// Parsing
+
+typedef std::map<std::string, std::string> Fields;
+
+// Parse one flat JSON object as written by ResultRecord::ToJson(): string
+// and number values only. Returns false on anything else.
+bool parse_json_record(const std::string& line, Fields& fields) {
+    size_t pos = 0;
+    auto skip_space = [&]() {
+        while (pos < line.size() && isspace(static_cast<unsigned char>(line[pos]))) {
+            pos++;
+        }
+    };
+    auto parse_string = [&](std::string& out) {
+        if (pos >= line.size() || line[pos] != '"') {
+            return false;
+        }
+        pos++;
+        while (pos < line.size() && line[pos] != '"') {
+            if (line[pos] == '\\' && pos + 1 < line.size()) {
+                pos++;
+                if (line[pos] == 'u' && pos + 4 < line.size()) {
+                    out += static_cast<char>(strtol(line.substr(pos + 1, 4).c_str(), NULL, 16));
+                    pos += 5;
+                    continue;
+                }
+                out += line[pos] == 'n' ? '\n' : line[pos] == 't' ? '\t' : line[pos];
+            } else {
+                out += line[pos];
+            }
+            pos++;
+        }
+        if (pos >= line.size()) {
+            return false;
+        }
+        pos++;
+        return true;
+    };
+
+    skip_space();
+    if (pos >= line.size() || line[pos] != '{') {
+        return false;
+    }
+    pos++;
+    while (true) {
+        skip_space();
+        if (pos < line.size() && line[pos] == '}') {
+            return true;
+        }
+        std::string key, value;
+        if (!parse_string(key)) {
+            return false;
+        }
+        skip_space();
+        if (pos >= line.size() || line[pos] != ':') {
+            return false;
+        }
+        pos++;
+        skip_space();
+        if (pos < line.size() && line[pos] == '"') {
+            if (!parse_string(value)) {
+                return false;
+            }
+        } else {
+            size_t end = line.find_first_of(",}", pos);
+            if (end == std::string::npos) {
+                return false;
+            }
+            value = line.substr(pos, end - pos);
+            value.erase(value.find_last_not_of(" \t") + 1);
+            pos = end;
+        }
+        fields[key] = value;
+        skip_space();
+        if (pos < line.size() && line[pos] == ',') {
+            pos++;
+        }
+    }
+}
+
+// Split one CSV line with "" quoting
+std::vector<std::string> split_csv(const std::string& line) {
+    std::vector<std::string> cells(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                cells.back() += '"';
+                i++;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                cells.back() += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            cells.emplace_back();
+        } else if (c != '\r') {
+            cells.back() += c;
+        }
+    }
+    return cells;
+}
+
+// Label without its epoch=N words, which number repetitions
+std::string label_without_epoch(const std::string& label) {
+    std::istringstream words(label);
+    std::string word, result;
+    while (words >> word) {
+        if (word.compare(0, 6, "epoch=") != 0) {
+            result += (result.empty() ? "" : " ") + word;
+        }
+    }
+    return result;
+}
+
+// Add a structured record; returns false if required fields are missing
+bool add_record(const Fields& fields, bool by_label, ResultSet& results) {
+    auto get = [&](const char* key) {
+        auto it = fields.find(key);
+        return it == fields.end() ? std::string() : it->second;
+    };
+    if (get("transport").empty() || get("total_ns").empty() || get("bytes").empty()) {
+        return false;
+    }
+
+    ConfigKey key;
+    key.transport = get("transport");
+    key.mode = get("mode");
+    key.bytes = strtoull(get("bytes").c_str(), NULL, 10);
+    key.iterations = strtoull(get("iterations").c_str(), NULL, 10);
+    key.timing = "loop";
+    // Mixed workloads report their mean size as bytes, pinned runs and
+    // open-loop or replayed runs measure something other than a plain run
+    auto add_variant = [&](const char* name, const std::string& value) {
+        key.variant += (key.variant.empty() ? "" : ",") + std::string(name) + "=" + value;
+    };
+    std::string workload = get("workload");
+    if (!workload.empty() && workload != "fixed") {
+        add_variant("workload", workload);
+    }
+    std::string cpu = get("cpu");
+    if (!cpu.empty() && cpu != "any") {
+        add_variant("cpu", cpu);
+    }
+    std::string replay = get("replay");
+    if (!replay.empty() && replay != "none") {
+        add_variant("replay", replay.substr(replay.find_last_of('/') + 1));
+    }
+    std::string rate = get("rate");
+    if (!rate.empty() && strtod(rate.c_str(), NULL) > 0) {
+        add_variant("rate", rate);
+    }
+    std::string label = label_without_epoch(get("label"));
+    if (by_label && !label.empty()) {
+        add_variant("label", label);
+    }
+
+    Run run;
+    run.seconds = strtod(get("total_ns").c_str(), NULL) / 1e9;
+    if (!get("latency_p99_ns").empty()) {
+        run.p99_ns = strtod(get("latency_p99_ns").c_str(), NULL);
+    }
+    results[key].push_back(run);
+    return true;
+}
+
+// "m:ss.ss" as printed by /usr/bin/time
+double parse_elapsed(const std::string& text) {
+    size_t colon = text.find(':');
+    if (colon == std::string::npos) {
+        return strtod(text.c_str(), NULL);
+    }
+    return atoi(text.substr(0, colon).c_str()) * 60 + strtod(text.c_str() + colon + 1, NULL);
+}
+
+// socket_large.txt -> socket
+std::string transport_from_path(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+    return name.substr(0, name.find_first_of("_."));
+}
+
+bool ends_with(const std::string& text, const char* suffix) {
+    size_t n = strlen(suffix);
+    return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
+}
+
+// legacy_transport overrides the transport of legacy text files, whose
+// names need not say it (socket-benchmark/results.txt)
+bool load_file(const std::string& path, const std::string& legacy_transport, bool by_label,
+               ResultSet& results) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Failed to open " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::string line;
+    size_t skipped = 0;
+    if (ends_with(path, ".csv")) {
+        std::vector<std::string> header;
+        while (std::getline(in, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            std::vector<std::string> cells = split_csv(line);
+            // Files appended to by several builds may repeat the header
+            if (!cells.empty() && cells[0] == "transport") {
+                header = cells;
+                continue;
+            }
+            Fields fields;
+            for (size_t i = 0; i < header.size() && i < cells.size(); ++i) {
+                fields[header[i]] = cells[i];
+            }
+            if (!add_record(fields, by_label, results)) {
+                skipped++;
+            }
+        }
+    } else if (ends_with(path, ".json") || ends_with(path, ".jsonl")) {
+        while (std::getline(in, line)) {
+            Fields fields;
+            if (!line.empty() && !(parse_json_record(line, fields) && add_record(fields, by_label, results))) {
+                skipped++;
+            }
+        }
+    } else {
+        // Legacy text: epoch [mode] bytes iterations m:ss.ss
+        std::string transport = legacy_transport.empty() ? transport_from_path(path) : legacy_transport;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string epoch, elapsed;
+            ConfigKey key;
+            key.transport = transport;
+            key.timing = "wall";
+            fields >> epoch;
+            if (fields >> std::ws && !isdigit(fields.peek())) {
+                fields >> key.mode;
+            }
+            if (!(fields >> key.bytes >> key.iterations >> elapsed)) {
+                if (!line.empty()) {
+                    skipped++;
+                }
+                continue;
+            }
+            Run run;
+            run.seconds = parse_elapsed(elapsed);
+            // 0:00.00 is below /usr/bin/time's 10 ms resolution
+            if (run.seconds <= 0) {
+                skipped++;
+                continue;
+            }
+            results[key].push_back(run);
+        }
+    }
+
+    if (skipped > 0) {
+        std::cerr << path << ": skipped " << skipped << " unparsable or zero-time lines" << std::endl;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+
+double median_of(std::vector<double> values) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// Value at quantile q with linear interpolation, values sorted
+double quantile_sorted(const std::vector<double>& values, double q) {
+    if (values.empty()) {
+        return 0;
+    }
+    double position = q * (values.size() - 1);
+    size_t lower = static_cast<size_t>(position);
+    size_t upper = std::min(lower + 1, values.size() - 1);
+    return values[lower] + (values[upper] - values[lower]) * (position - lower);
+}
+
+// Percentile bootstrap 95% interval of the median. The generator is seeded
+// per configuration so repeated analyses print the same intervals.
+void bootstrap_median_ci(const std::vector<double>& values, int resamples, uint64_t seed,
+                         double* low, double* high) {
+    if (values.size() < 2) {
+        *low = *high = values.empty() ? 0 : values[0];
+        return;
+    }
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, values.size() - 1);
+    std::vector<double> sample(values.size());
+    std::vector<double> medians;
+    medians.reserve(resamples);
+    for (int r = 0; r < resamples; ++r) {
+        for (double& value : sample) {
+            value = values[pick(rng)];
+        }
+        medians.push_back(median_of(sample));
+    }
+    std::sort(medians.begin(), medians.end());
+    *low = quantile_sorted(medians, 0.025);
+    *high = quantile_sorted(medians, 0.975);
+}
+
+// Runs outside Tukey's fences (1.5 IQR beyond the quartiles)
+size_t count_outliers(std::vector<double> values) {
+    if (values.size() < 4) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    double q1 = quantile_sorted(values, 0.25);
+    double q3 = quantile_sorted(values, 0.75);
+    double fence = 1.5 * (q3 - q1);
+    size_t outliers = 0;
+    for (double value : values) {
+        if (value < q1 - fence || value > q3 + fence) {
+            outliers++;
+        }
+    }
+    return outliers;
+}
+
+ConfigSummary summarize(const ConfigKey& key, const std::vector<Run>& runs, int resamples) {
+    ConfigSummary summary;
+    std::vector<double> seconds;
+    std::vector<double> p99s;
+    for (const Run& run : runs) {
+        seconds.push_back(run.seconds);
+        if (run.p99_ns >= 0) {
+            p99s.push_back(run.p99_ns);
+        }
+    }
+
+    summary.runs = runs.size();
+    summary.median_s = median_of(seconds);
+    uint64_t seed = std::hash<std::string>()(key.transport + key.mode + key.variant) ^ (key.bytes * 31 + key.iterations);
+    bootstrap_median_ci(seconds, resamples, seed, &summary.ci_low_s, &summary.ci_high_s);
+    if (summary.median_s > 0) {
+        summary.requests_per_s = key.iterations / summary.median_s;
+        summary.mb_per_s = summary.requests_per_s * key.bytes / (1024 * 1024);
+    }
+    if (!p99s.empty()) {
+        summary.p99_ns = median_of(p99s);
+    }
+    summary.outliers = count_outliers(seconds);
+    return summary;
+}
+
+// ---------------------------------------------------------------------------
+// Output
+
+void print_summary_table(const std::map<ConfigKey, ConfigSummary>& summaries) {
+    printf("%-8s %-10s %10s %8s %-4s %4s %11s %23s %12s %10s %10s %4s  %s\n",
+           "transport", "mode", "bytes", "calls", "time", "runs", "median_s", "95% CI", "req/s", "MB/s",
+           "p99_us", "out", "variant");
+    for (const auto& entry : summaries) {
+        const ConfigKey& key = entry.first;
+        const ConfigSummary& s = entry.second;
+        char ci[48];
+        snprintf(ci, sizeof(ci), "[%.4f, %.4f]", s.ci_low_s, s.ci_high_s);
+        char p99[24] = "-";
+        if (s.p99_ns >= 0) {
+            snprintf(p99, sizeof(p99), "%.1f", s.p99_ns / 1000);
+        }
+        printf("%-8s %-10s %10llu %8llu %-4s %4zu %11.4f %23s %12.0f %10.2f %10s %4s  %s\n",
+               key.transport.c_str(), key.mode.empty() ? "-" : key.mode.c_str(),
+               static_cast<unsigned long long>(key.bytes),
+               static_cast<unsigned long long>(key.iterations), key.timing.c_str(), s.runs, s.median_s, ci,
+               s.requests_per_s, s.mb_per_s, p99, s.outliers > 0 ? std::to_string(s.outliers).c_str() : "",
+               key.variant.empty() ? "-" : key.variant.c_str());
+    }
+}
+
+// One whitespace-separated file per transport, mode, timing and variant,
+// sorted by bytes and calls, for gnuplot or matplotlib
+bool write_data_files(const std::string& dir, const std::map<ConfigKey, ConfigSummary>& summaries) {
+    std::map<std::string, FILE*> files;
+    bool ok = true;
+    for (const auto& entry : summaries) {
+        const ConfigKey& key = entry.first;
+        const ConfigSummary& s = entry.second;
+        std::string name = key.transport + (key.mode.empty() ? "" : "_" + key.mode) +
+                           (key.timing == "wall" ? "_wall" : "");
+        if (!key.variant.empty()) {
+            std::string variant = key.variant;
+            for (char& c : variant) {
+                if (!isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-') {
+                    c = '_';
+                }
+            }
+            name += "_" + variant;
+        }
+        FILE*& file = files[name];
+        if (file == NULL) {
+            std::string path = dir + "/" + name + ".dat";
+            file = fopen(path.c_str(), "w");
+            if (file == NULL) {
+                std::cerr << "Failed to create " << path << ": " << strerror(errno) << std::endl;
+                ok = false;
+                continue;
+            }
+            fprintf(file, "# bytes calls runs median_s ci_low_s ci_high_s requests_per_s mb_per_s p99_ns outliers\n");
+        }
+        // p99 is nan when the source had no per-call latencies
+        fprintf(file, "%llu %llu %zu %.6f %.6f %.6f %.1f %.3f %.0f %zu\n",
+                static_cast<unsigned long long>(key.bytes),
+                static_cast<unsigned long long>(key.iterations), s.runs, s.median_s,
+                s.ci_low_s, s.ci_high_s, s.requests_per_s, s.mb_per_s,
+                s.p99_ns >= 0 ? s.p99_ns : NAN, s.outliers);
+    }
+    for (auto& entry : files) {
+        if (entry.second != NULL) {
+            fclose(entry.second);
+        }
+    }
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Baseline comparison
+
+enum Verdict { VERDICT_SAME, VERDICT_REGRESSED, VERDICT_IMPROVED, VERDICT_UNTESTED };
+
+const char* verdict_name(Verdict verdict) {
+    switch (verdict) {
+        case VERDICT_REGRESSED: return "REGRESSED";
+        case VERDICT_IMPROVED: return "improved";
+        case VERDICT_UNTESTED: return "too few runs";
+        default: return "ok";
+    }
+}
+
+// One-sided Mann-Whitney U test that values in a tend to be larger than in
+// b. Normal approximation with tie and continuity correction, adequate from
+// about 4 runs per side.
+double mann_whitney_greater(const std::vector<double>& a, const std::vector<double>& b) {
+    std::vector<std::pair<double, int>> all;
+    for (double value : a) {
+        all.push_back({value, 0});
+    }
+    for (double value : b) {
+        all.push_back({value, 1});
+    }
+    std::sort(all.begin(), all.end());
+
+    // Rank sum of a, with ties given their average rank
+    double rank_sum_a = 0;
+    double tie_term = 0;
+    size_t n = all.size();
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && all[j].first == all[i].first) {
+            j++;
+        }
+        double rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; ++k) {
+            if (all[k].second == 0) {
+                rank_sum_a += rank;
+            }
+        }
+        double t = j - i;
+        tie_term += t * t * t - t;
+        i = j;
+    }
+
+    double n1 = a.size();
+    double n2 = b.size();
+    double u = rank_sum_a - n1 * (n1 + 1) / 2;
+    double variance = n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1.0)));
+    if (variance <= 0) {
+        return 1;
+    }
+    double z = (u - n1 * n2 / 2 - 0.5) / sqrt(variance);
+    return 0.5 * erfc(z / M_SQRT2);
+}
+
+struct Comparison {
+    double baseline = 0;
+    double current = 0;
+    double change = 0;     // relative, +0.10 = 10% slower
+    double p_value = -1;   // -1 when the CI fallback was used
+    Verdict verdict = VERDICT_SAME;
+};
+
+// Lower is better for both metrics compared here. With enough runs on both
+// sides the slowdown must be significant and above the threshold; with
+// fewer, the bootstrap intervals of the medians must not overlap.
+Comparison compare_samples(const std::vector<double>& baseline, const std::vector<double>& current,
+                           int resamples, double threshold, double alpha) {
+    Comparison result;
+    result.baseline = median_of(baseline);
+    result.current = median_of(current);
+    result.change = result.baseline > 0 ? result.current / result.baseline - 1 : 0;
+
+    const size_t kMinRunsForTest = 4;
+    if (baseline.size() >= kMinRunsForTest && current.size() >= kMinRunsForTest) {
+        result.p_value = mann_whitney_greater(current, baseline);
+        double p_faster = mann_whitney_greater(baseline, current);
+        if (result.change > threshold && result.p_value < alpha) {
+            result.verdict = VERDICT_REGRESSED;
+        } else if (result.change < -threshold && p_faster < alpha) {
+            result.verdict = VERDICT_IMPROVED;
+        }
+        return result;
+    }
+    if (baseline.size() < 2 || current.size() < 2) {
+        result.verdict = VERDICT_UNTESTED;
+        return result;
+    }
+    double base_low, base_high, current_low, current_high;
+    bootstrap_median_ci(baseline, resamples, 1, &base_low, &base_high);
+    bootstrap_median_ci(current, resamples, 2, &current_low, &current_high);
+    if (result.change > threshold && current_low > base_high) {
+        result.verdict = VERDICT_REGRESSED;
+    } else if (result.change < -threshold && current_high < base_low) {
+        result.verdict = VERDICT_IMPROVED;
+    }
+    return result;
+}
+
+void print_comparison_row(const ConfigKey& key, const char* metric, const Comparison& c, double scale) {
+    char p[16] = "ci";
+    if (c.p_value >= 0) {
+        snprintf(p, sizeof(p), "%.4f", c.p_value);
+    }
+    printf("%-8s %-10s %10llu %8llu %-4s %-6s %12.4f %12.4f %+8.1f%% %7s  %-12s %s\n",
+           key.transport.c_str(), key.mode.empty() ? "-" : key.mode.c_str(),
+           static_cast<unsigned long long>(key.bytes),
+           static_cast<unsigned long long>(key.iterations), key.timing.c_str(), metric,
+           c.baseline * scale, c.current * scale, 100 * c.change, p, verdict_name(c.verdict),
+           key.variant.empty() ? "-" : key.variant.c_str());
+}
+
+// Baseline runs for key: the same configuration, or for connect mode a
+// baseline without a mode (legacy text files from before connection modes,
+// when every call connected). NULL if there are none.
+const std::vector<Run>* find_baseline(const ResultSet& baseline, const ConfigKey& key) {
+    auto base = baseline.find(key);
+    if (base == baseline.end() && key.mode == "connect") {
+        ConfigKey no_mode = key;
+        no_mode.mode.clear();
+        base = baseline.find(no_mode);
+    }
+    return base == baseline.end() ? NULL : &base->second;
+}
+
+// Compare every configuration in current that the baseline also has, with
+// the same timing. Returns the number of regressions and sets *compared.
+int compare_with_baseline(const ResultSet& baseline, const ResultSet& current, int resamples,
+                          double threshold, double alpha, size_t* compared) {
+    printf("%-8s %-10s %10s %8s %-4s %-6s %12s %12s %9s %7s  %-12s %s\n",
+           "transport", "mode", "bytes", "calls", "time", "metric", "baseline", "current", "change", "p",
+           "verdict", "variant");
+    int regressions = 0;
+    *compared = 0;
+    for (const auto& entry : current) {
+        const ConfigKey& key = entry.first;
+        const std::vector<Run>* base = find_baseline(baseline, key);
+        if (base == NULL) {
+            // Whole-process and loop-only times differ by startup cost, so
+            // a baseline of the other kind is reported rather than compared
+            ConfigKey other = key;
+            other.timing = key.timing == "wall" ? "loop" : "wall";
+            if (find_baseline(baseline, other) != NULL) {
+                printf("# %s %s %llu %llu %s: baseline has only %s time, not compared\n",
+                       key.transport.c_str(), key.mode.empty() ? "-" : key.mode.c_str(),
+                       static_cast<unsigned long long>(key.bytes),
+                       static_cast<unsigned long long>(key.iterations),
+                       key.variant.empty() ? "-" : key.variant.c_str(), other.timing.c_str());
+            }
+            continue;
+        }
+        (*compared)++;
+
+        std::vector<double> base_seconds, current_seconds, base_p99, current_p99;
+        for (const Run& run : *base) {
+            base_seconds.push_back(run.seconds);
+            if (run.p99_ns >= 0) {
+                base_p99.push_back(run.p99_ns);
+            }
+        }
+        for (const Run& run : entry.second) {
+            current_seconds.push_back(run.seconds);
+            if (run.p99_ns >= 0) {
+                current_p99.push_back(run.p99_ns);
+            }
+        }
+
+        Comparison median = compare_samples(base_seconds, current_seconds, resamples, threshold, alpha);
+        print_comparison_row(key, "time_s", median, 1);
+        regressions += median.verdict == VERDICT_REGRESSED;
+        if (!base_p99.empty() && !current_p99.empty()) {
+            Comparison p99 = compare_samples(base_p99, current_p99, resamples, threshold, alpha);
+            print_comparison_row(key, "p99_us", p99, 1e-3);
+            regressions += p99.verdict == VERDICT_REGRESSED;
+        }
+    }
+    printf("# %zu configurations compared, %d regressions (threshold %.1f%%, alpha %g)\n",
+           *compared, regressions, 100 * threshold, alpha);
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    std::string data_dir;
+    int resamples = 2000;
+    std::vector<std::string> baseline_files;
+    double threshold = 0.05;
+    double alpha = 0.05;
+    std::string legacy_transport;
+    bool by_label = false;
+
+    static struct option long_options[] = {
+        {"data-dir", required_argument, 0, 'd'},
+        {"resamples", required_argument, 0, 'r'},
+        {"baseline", required_argument, 0, 'B'},
+        {"threshold", required_argument, 0, 't'},
+        {"alpha", required_argument, 0, 'a'},
+        {"transport", required_argument, 0, 'T'},
+        {"by-label", no_argument, 0, 'l'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "d:r:B:t:a:T:lh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'd':
+                data_dir = optarg;
+                break;
+            case 'r':
+                resamples = atoi(optarg);
+                if (resamples <= 0) {
+                    fprintf(stderr, "Error: resamples must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'B':
+                baseline_files.push_back(optarg);
+                break;
+            case 't':
+                threshold = atof(optarg) / 100;
+                if (threshold < 0) {
+                    fprintf(stderr, "Error: threshold must not be negative\n");
+                    return 1;
+                }
+                break;
+            case 'a':
+                alpha = atof(optarg);
+                if (alpha <= 0 || alpha >= 1) {
+                    fprintf(stderr, "Error: alpha must be between 0 and 1\n");
+                    return 1;
+                }
+                break;
+            case 'T':
+                legacy_transport = optarg;
+                break;
+            case 'l':
+                by_label = true;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            case '?':
+                print_usage(argv[0]);
+                return 1;
+            default:
+                abort();
+        }
+    }
+
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    ResultSet results;
+    for (int i = optind; i < argc; ++i) {
+        if (!load_file(argv[i], legacy_transport, by_label, results)) {
+            return 1;
+        }
+    }
+
+    std::map<ConfigKey, ConfigSummary> summaries;
+    for (const auto& entry : results) {
+        summaries[entry.first] = summarize(entry.first, entry.second, resamples);
+    }
+
+    print_summary_table(summaries);
+    if (!data_dir.empty() && !write_data_files(data_dir, summaries)) {
+        return 1;
+    }
+
+    if (!baseline_files.empty()) {
+        ResultSet baseline;
+        for (const std::string& path : baseline_files) {
+            if (!load_file(path, legacy_transport, by_label, baseline)) {
+                return 1;
+            }
+        }
+        printf("\n");
+        size_t compared = 0;
+        if (compare_with_baseline(baseline, results, resamples, threshold, alpha, &compared) > 0) {
+            return 2;
+        }
+        // A gate that compared nothing must not pass
+        if (compared == 0) {
+            fprintf(stderr, "Error: no configuration is in both the baseline and the current results\n");
+            return 3;
+        }
+    }
+    return 0;
+}
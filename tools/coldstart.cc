@@ -0,0 +1,290 @@
+/*
+ * Cold-start launcher
+ * Repeatedly spawns a client for a single request and breaks the time from
+ * spawn to exit down into exec, loading, transport setup and first response
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "startup_timer.h"
+
+extern char** environ;
+
+// Phases reported per run, in order. Each one ends at the named timestamp;
+// the client-side marks come from StartupReport in startup_timer.h.
+struct Phase {
+    const char* name;
+    const char* end_mark;
+};
+
+const Phase PHASES[] = {
+    {"exec", "spawned"},                 // fork/exec until posix_spawn returns
+    {"load_init", "constructor"},        // dynamic loading and library static init
+    {"pre_main", "main"},                // executable static init
+    {"transport_init", "transport"},     // channel / client creation
+    {"first_call", "first_response"},    // connect and first request
+    {"exit", "exited"},                  // teardown until waitpid returns
+};
+
+void print_usage(const char *program_name) {
+    printf("Usage: %s [OPTIONS] -- COMMAND [ARGS...]\n", program_name);
+    printf("Options:\n");
+    printf("  -r, --repetitions NUM   Number of cold starts (default: 100)\n");
+    printf("  -f, --fd NUM            Descriptor the command writes startup marks to (default: 3),\n");
+    printf("                          pass the same number to the client, e.g. socket_client -S 3\n");
+    printf("  -L, --loader-stats NUM  Extra runs with LD_DEBUG=statistics to measure the\n");
+    printf("                          dynamic loader on its own (default: 0)\n");
+    printf("  -l, --label NAME        Label written at the start of each result line\n");
+    printf("  -h, --help              Show this help message\n");
+    printf("\n");
+    printf("Prints one line per run: label run total_us followed by each phase in us\n");
+    printf("(exec load_init pre_main transport_init first_call exit), then a median line.\n");
+}
+
+// Parse "name=ns name=ns ..." as written by StartupReport::Finish()
+void parse_marks(const std::string& line, std::map<std::string, uint64_t>& marks) {
+    size_t pos = 0;
+    while (pos < line.size()) {
+        size_t end = line.find_first_of(" \n", pos);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+        std::string field = line.substr(pos, end - pos);
+        size_t eq = field.find('=');
+        if (eq != std::string::npos) {
+            marks[field.substr(0, eq)] = strtoull(field.c_str() + eq + 1, NULL, 10);
+        }
+        pos = end + 1;
+    }
+}
+
+std::string read_all(int fd) {
+    std::string data;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        data.append(buffer, n);
+    }
+    return data;
+}
+
+// Spawn the command once. The child gets the write end of a pipe as
+// report_fd (or as stderr with capture_stderr). Returns false if the command
+// could not be started or exited with an error.
+bool run_once(char** argv, int report_fd, bool capture_stderr, char** envp,
+              std::map<std::string, uint64_t>& marks, std::string& output) {
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) < 0) {
+        std::cerr << "pipe2 failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], capture_stderr ? STDERR_FILENO : report_fd);
+
+    uint64_t start_ns = startup_monotonic_ns();
+    pid_t pid;
+    int rc = posix_spawnp(&pid, argv[0], &actions, NULL, argv, envp);
+    // glibc's posix_spawn returns once the child has called execve
+    uint64_t spawned_ns = startup_monotonic_ns();
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipe_fds[1]);
+
+    if (rc != 0) {
+        std::cerr << "Failed to spawn " << argv[0] << ": " << strerror(rc) << std::endl;
+        close(pipe_fds[0]);
+        return false;
+    }
+
+    output = read_all(pipe_fds[0]);
+    close(pipe_fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    uint64_t exited_ns = startup_monotonic_ns();
+
+    marks.clear();
+    marks["start"] = start_ns;
+    marks["spawned"] = spawned_ns;
+    if (!capture_stderr) {
+        parse_marks(output, marks);
+    }
+    marks["exited"] = exited_ns;
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << argv[0] << " exited with status " << status << std::endl;
+        return false;
+    }
+    return true;
+}
+
+uint64_t median(std::vector<uint64_t> values) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    int repetitions = 100;
+    int report_fd = 3;
+    int loader_runs = 0;
+    std::string label = "run";
+
+    static struct option long_options[] = {
+        {"repetitions", required_argument, 0, 'r'},
+        {"fd", required_argument, 0, 'f'},
+        {"loader-stats", required_argument, 0, 'L'},
+        {"label", required_argument, 0, 'l'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    // '+' stops at the first non-option so the command's own flags pass through
+    while ((c = getopt_long(argc, argv, "+r:f:L:l:h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'r':
+                repetitions = atoi(optarg);
+                if (repetitions <= 0) {
+                    fprintf(stderr, "Error: repetitions must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'f':
+                report_fd = atoi(optarg);
+                if (report_fd <= STDERR_FILENO) {
+                    fprintf(stderr, "Error: report fd must be greater than 2\n");
+                    return 1;
+                }
+                break;
+            case 'L':
+                loader_runs = atoi(optarg);
+                if (loader_runs < 0) {
+                    fprintf(stderr, "Error: loader runs must be non-negative\n");
+                    return 1;
+                }
+                break;
+            case 'l':
+                label = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            case '?':
+                print_usage(argv[0]);
+                return 1;
+            default:
+                abort();
+        }
+    }
+
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    char** command = argv + optind;
+
+    const size_t num_phases = sizeof(PHASES) / sizeof(PHASES[0]);
+    std::vector<std::vector<uint64_t>> phase_us(num_phases);
+    std::vector<uint64_t> total_us;
+    int failures = 0;
+
+    for (int run = 0; run < repetitions; ++run) {
+        std::map<std::string, uint64_t> marks;
+        std::string output;
+        if (!run_once(command, report_fd, false, environ, marks, output)) {
+            failures++;
+            continue;
+        }
+
+        uint64_t total = (marks["exited"] - marks["start"]) / 1000;
+        total_us.push_back(total);
+        printf("%s %d %llu", label.c_str(), run, static_cast<unsigned long long>(total));
+
+        // A phase whose mark is missing (e.g. a client without --startup-fd)
+        // is folded into the next one that has a mark, and printed as -
+        uint64_t previous = marks["start"];
+        for (size_t p = 0; p < num_phases; ++p) {
+            auto it = marks.find(PHASES[p].end_mark);
+            if (it == marks.end()) {
+                printf(" -");
+                continue;
+            }
+            uint64_t us = it->second > previous ? (it->second - previous) / 1000 : 0;
+            phase_us[p].push_back(us);
+            printf(" %llu", static_cast<unsigned long long>(us));
+            previous = it->second;
+        }
+        printf("\n");
+    }
+
+    printf("# %s median total_us %llu", label.c_str(),
+           static_cast<unsigned long long>(median(total_us)));
+    for (size_t p = 0; p < num_phases; ++p) {
+        if (phase_us[p].empty()) {
+            continue;
+        }
+        printf(" %s %llu", PHASES[p].name, static_cast<unsigned long long>(median(phase_us[p])));
+    }
+    printf("\n");
+
+    // The loader's own statistics are printed in TSC cycles
+    if (loader_runs > 0) {
+        std::vector<char*> envp;
+        for (char** env = environ; *env != NULL; ++env) {
+            envp.push_back(*env);
+        }
+        static char ld_debug[] = "LD_DEBUG=statistics";
+        envp.push_back(ld_debug);
+        envp.push_back(NULL);
+
+        double ticks_per_ns = tsc_ticks_per_ns();
+        std::vector<uint64_t> loader_us;
+        for (int run = 0; run < loader_runs; ++run) {
+            std::map<std::string, uint64_t> marks;
+            std::string output;
+            run_once(command, report_fd, true, envp.data(), marks, output);
+            const char* key = "total startup time in dynamic loader: ";
+            size_t pos = output.find(key);
+            if (pos == std::string::npos || ticks_per_ns <= 0) {
+                continue;
+            }
+            uint64_t cycles = strtoull(output.c_str() + pos + strlen(key), NULL, 10);
+            loader_us.push_back(static_cast<uint64_t>(cycles / ticks_per_ns / 1000));
+        }
+        if (!loader_us.empty()) {
+            printf("# %s median dynamic_loader_us %llu\n", label.c_str(),
+                   static_cast<unsigned long long>(median(loader_us)));
+        } else {
+            printf("# %s dynamic loader statistics unavailable\n", label.c_str());
+        }
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "%d of %d runs failed\n", failures, repetitions);
+    }
+    return failures == 0 ? 0 : 1;
+}
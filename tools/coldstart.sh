@@ -0,0 +1,73 @@
+#!/bin/bash
+set -e # exit on error
+# set -x # print commands
+
+# Cold-start benchmark: spawn each transport's client for a single request
+# and record exec, loading, transport setup, first response and exit times.
+# Expects socket-benchmark/build and grpc-benchmark/build to exist.
+
+cd "$(dirname "$0")"
+ROOT=$(pwd)/..
+SOCKET_PATH="/tmp/randombytes_socket"
+REPETITIONS=200
+
+# Build the tools if build directory doesn't exist
+if [ ! -d "build" ]; then
+    echo "Building benchmark tools..."
+    mkdir -p build
+    cd build
+    cmake ..
+    make -j$(nproc)
+    cd ..
+fi
+
+cleanup() {
+    echo "Cleaning up..."
+    for pid in $SOCKET_PID $GRPC_PID; do
+        kill $pid 2>/dev/null || true
+    done
+    rm -f "$SOCKET_PATH"
+}
+trap cleanup EXIT
+
+# Start a server with a readiness pipe on fd 3 and wait for READY=1
+start_server() {
+    local fifo=$(mktemp -u)
+    mkfifo "$fifo"
+    "$@" 3>"$fifo" > /dev/null &
+    STARTED_PID=$!
+    read -t 30 ready < "$fifo" || true
+    rm -f "$fifo"
+    if [ "$ready" != "READY=1" ]; then
+        echo "Error: $1 failed to start"
+        exit 1
+    fi
+}
+
+main() {
+    start_server "$ROOT/socket-benchmark/build/socket_server" -s "$SOCKET_PATH" --ready-fd 3
+    SOCKET_PID=$STARTED_PID
+    start_server "$ROOT/grpc-benchmark/build/randombytes_server" --ready_fd=3
+    GRPC_PID=$STARTED_PID
+
+    for B in 1 32 1024; do
+        echo "Cold start: socket, $B bytes"
+        ./build/coldstart -r $REPETITIONS -L 20 -l "socket $B" -- \
+            "$ROOT/socket-benchmark/build/socket_client" -n 1 -b $B -q -s "$SOCKET_PATH" -S 3 >> coldstart.txt
+        echo "Cold start: grpc, $B bytes"
+        ./build/coldstart -r $REPETITIONS -L 20 -l "grpc $B" -- \
+            "$ROOT/grpc-benchmark/build/randombytes_client" -n 1 -b $B -q -S 3 >> coldstart.txt
+        if command -v sd-bus-client > /dev/null; then
+            # The D-Bus client has no startup marks, only exec and total are split out
+            echo "Cold start: dbus, $B bytes"
+            ./build/coldstart -r $REPETITIONS -L 20 -l "dbus $B" -- \
+                sd-bus-client -n 1 -b $B -t 0 -q >> coldstart.txt
+        fi
+    done
+
+    echo "Cold start benchmark completed. Results saved to tools/coldstart.txt"
+    echo "(transport bytes run total_us exec load_init pre_main transport_init first_call exit)"
+    grep "^#" coldstart.txt | tail -n 9
+}
+
+main
@@ -0,0 +1,175 @@
+#!/bin/bash
+set -e # exit on error
+# set -x # print commands
+
+# Interleaved benchmark: every epoch runs all transports and configurations
+# in a new random order, so frequency drift, thermal throttling and
+# background noise spread evenly over the transports instead of biasing
+# whichever ran last. The CPU frequency is sampled while each cell runs and
+# the throttle counters are read around it; cells measured while throttled
+# are flagged.
+# Expects socket-benchmark/build and grpc-benchmark/build to exist.
+
+cd "$(dirname "$0")"
+ROOT=$(pwd)/..
+SOCKET_PATH="/tmp/randombytes_socket"
+EPOCHS=${EPOCHS:-10}
+SEED=${SEED:-}          # set for a reproducible order
+LOG=interleaved.txt
+SAMPLE_INTERVAL=${SAMPLE_INTERVAL:-0.1}   # seconds between frequency samples
+
+cleanup() {
+    echo "Cleaning up..."
+    for pid in $SAMPLER_PID $SOCKET_PID $GRPC_PID; do
+        kill $pid 2>/dev/null || true
+    done
+    rm -f "$SOCKET_PATH" out.txt mhz.txt
+}
+trap cleanup EXIT
+
+# Start a server with a readiness pipe on fd 3 and wait for READY=1
+start_server() {
+    local fifo=$(mktemp -u)
+    mkfifo "$fifo"
+    "$@" 3>"$fifo" > /dev/null &
+    STARTED_PID=$!
+    read -t 30 ready < "$fifo" || true
+    rm -f "$fifo"
+    if [ "$ready" != "READY=1" ]; then
+        echo "Error: $1 failed to start"
+        exit 1
+    fi
+}
+
+# Highest current frequency over all CPUs in MHz, from cpufreq or
+# /proc/cpuinfo. Idle CPUs clock down, so the busiest one is the signal.
+cpu_mhz() {
+    if ls /sys/devices/system/cpu/cpu*/cpufreq/scaling_cur_freq > /dev/null 2>&1; then
+        cat /sys/devices/system/cpu/cpu*/cpufreq/scaling_cur_freq | awk '$1 > m {m = $1} END {printf "%.0f", m / 1000}'
+    else
+        awk -F: '/^cpu MHz/ && $2 > m {m = $2} END {printf "%.0f", m}' /proc/cpuinfo
+    fi
+}
+
+# Sum of the core and package thermal throttle event counters (0 if absent)
+throttle_count() {
+    cat /sys/devices/system/cpu/cpu*/thermal_throttle/*_throttle_count 2>/dev/null | awk '{s += $1} END {print s + 0}'
+}
+
+# Nominal (non-turbo) frequency in MHz; running below it means throttling.
+# 0 when the driver does not report it, which disables the frequency check:
+# cpuinfo_max_freq is the turbo maximum, which most busy cells never hold.
+base_mhz() {
+    local cpufreq=/sys/devices/system/cpu/cpu0/cpufreq
+    if [ -r $cpufreq/base_frequency ]; then
+        echo $(( $(cat $cpufreq/base_frequency) / 1000 ))
+    else
+        echo 0
+    fi
+}
+
+# Sample cpu_mhz into mhz.txt every SAMPLE_INTERVAL until stop_sampler,
+# starting immediately so even a short cell gets one sample
+start_sampler() {
+    while true; do
+        cpu_mhz
+        echo
+        sleep $SAMPLE_INTERVAL
+    done > mhz.txt &
+    SAMPLER_PID=$!
+}
+
+# Stop the sampler and set CELL_MHZ to the mean of its samples
+stop_sampler() {
+    kill $SAMPLER_PID 2>/dev/null || true
+    wait $SAMPLER_PID 2>/dev/null || true
+    SAMPLER_PID=
+    CELL_MHZ=$(awk 'NF {s += $1; n++} END {printf "%.0f", n ? s / n : 0}' mhz.txt)
+}
+
+# Run one cell; sets CELL_TIME to the elapsed m:ss.ss
+run_cell() {
+    local epoch=$1 order=$2 transport=$3 B=$4 N=$5
+    local label="interleaved epoch=$epoch order=$order"
+    case $transport in
+        socket)
+            /usr/bin/time -v -o out.txt "$ROOT/socket-benchmark/build/socket_client" -n $N -b $B -t 0 -q \
+                -s "$SOCKET_PATH" -o interleaved.jsonl -L "$label"
+            ;;
+        grpc)
+            /usr/bin/time -v -o out.txt "$ROOT/grpc-benchmark/build/randombytes_client" -n $N -b $B -t 0 -q \
+                -o interleaved.jsonl -L "$label"
+            ;;
+        dbus)
+            /usr/bin/time -v -o out.txt sd-bus-client -n $N -b $B -t 0 -q
+            ;;
+    esac
+    CELL_TIME=$(cat out.txt | grep "m:ss): " | cut -c 47-)
+}
+
+main() {
+    start_server "$ROOT/socket-benchmark/build/socket_server" -s "$SOCKET_PATH" --ready-fd 3
+    SOCKET_PID=$STARTED_PID
+    start_server "$ROOT/grpc-benchmark/build/randombytes_server" --ready_fd=3
+    GRPC_PID=$STARTED_PID
+
+    TRANSPORTS="socket grpc"
+    if command -v sd-bus-client > /dev/null; then
+        TRANSPORTS="$TRANSPORTS dbus"
+    fi
+
+    CELLS=()
+    for transport in $TRANSPORTS; do
+        for B in 1 32 1024; do
+            for N in 1000 10000 25000; do
+                CELLS+=("$transport $B $N")
+            done
+        done
+    done
+
+    local base=$(base_mhz)
+    echo "Interleaving ${#CELLS[@]} cells over $EPOCHS epochs (base frequency ${base} MHz)"
+
+    for epoch in $(seq 1 $EPOCHS); do
+        if [ -n "$SEED" ]; then
+            # Hash so every epoch's random stream differs from its first byte
+            shuffled=$(printf '%s\n' "${CELLS[@]}" | shuf --random-source=<(yes "$(echo "$SEED.$epoch" | sha256sum)"))
+        else
+            shuffled=$(printf '%s\n' "${CELLS[@]}" | shuf)
+        fi
+
+        order=0
+        while read transport B N; do
+            order=$((order + 1))
+            echo "Running epoch $epoch cell $order: $transport, $N iterations, $B bytes per call"
+            mhz_before=$(cpu_mhz)
+            throttle_before=$(throttle_count)
+            start_sampler
+            run_cell $epoch $order $transport $B $N < /dev/null
+            stop_sampler
+            throttle_events=$(( $(throttle_count) - throttle_before ))
+
+            flag=ok
+            if [ $throttle_events -gt 0 ]; then
+                flag=throttled
+            elif [ $base -gt 0 ] && [ $CELL_MHZ -gt 0 ] && [ $CELL_MHZ -lt $base ]; then
+                # Mean of the samples taken while the client ran; 0 if the
+                # cell ended before the first sample
+                flag=below_base
+            fi
+
+            echo "$epoch $order $transport $B $N $CELL_TIME $mhz_before $CELL_MHZ $throttle_events $flag" >> $LOG
+            # Unflagged cells also go to per-transport files in the
+            # benchmark-results format for tools/analyze_results
+            if [ $flag = ok ]; then
+                echo "$epoch $B $N $CELL_TIME" >> ${transport}_interleaved.txt
+            fi
+        done <<< "$shuffled"
+    done
+
+    echo "Interleaved benchmark completed. Results saved to tools/$LOG"
+    echo "(epoch order transport bytes iterations time mhz_before mhz_during throttle_events flag)"
+    echo "Flagged cells: $(awk '$10 != "ok"' $LOG | wc -l) of $(wc -l < $LOG)"
+}
+
+main
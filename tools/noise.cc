@@ -0,0 +1,227 @@
+/*
+ * Background load generator for the noisy-neighbor benchmark
+ * Streams memory through large buffers, forks short-lived children or spins
+ * on the CPU from several threads until the duration ends or it is
+ * signalled, then reports how much work it did
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <getopt.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static std::atomic<bool> running(true);
+
+void handle_signal(int) {
+    running.store(false, std::memory_order_relaxed);
+}
+
+void print_usage(const char *program_name) {
+    printf("Usage: %s [OPTIONS]\n", program_name);
+    printf("Options:\n");
+    printf("  -t, --type TYPE         membw, fork or cpu (default: membw)\n");
+    printf("  -j, --threads NUM       Load threads (default: 1)\n");
+    printf("  -d, --duration SEC      Stop after SEC seconds (default: 0 = until SIGINT/SIGTERM)\n");
+    printf("  -m, --buffer-mb MB      Size of each of a membw thread's two buffers (default: from the\n");
+    printf("                          LLC size, so all threads together stream 4x the LLC, at least 8)\n");
+    printf("  -h, --help              Show this help message\n");
+}
+
+// Size of CPU 0's highest-level cache in bytes, or 0 if sysfs does not say
+uint64_t llc_bytes() {
+    uint64_t bytes = 0;
+    int best_level = 0;
+    for (int index = 0; index < 16; ++index) {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index);
+        std::ifstream level_file(dir + "/level");
+        std::ifstream size_file(dir + "/size");
+        int level = 0;
+        uint64_t size = 0;
+        std::string unit;
+        if (!(level_file >> level) || !(size_file >> size)) {
+            continue;
+        }
+        size_file >> unit;   // "K" or "M" right after the number
+        size <<= unit == "M" ? 20 : unit == "K" ? 10 : 0;
+        if (level > best_level) {
+            best_level = level;
+            bytes = size;
+        }
+    }
+    return bytes;
+}
+
+// Copy between two buffers so every pass misses the caches. Returns bytes
+// moved.
+uint64_t memory_bandwidth_load(size_t buffer_bytes) {
+    std::vector<char> source(buffer_bytes, 1);
+    std::vector<char> destination(buffer_bytes, 0);
+    uint64_t bytes = 0;
+    while (running.load(std::memory_order_relaxed)) {
+        memcpy(destination.data(), source.data(), buffer_bytes);
+        source.swap(destination);
+        bytes += buffer_bytes;
+    }
+    return bytes;
+}
+
+// fork() + _exit() + waitpid(): page table copies, TLB shootdowns and
+// scheduler churn. Returns children reaped.
+uint64_t fork_load() {
+    uint64_t forks = 0;
+    while (running.load(std::memory_order_relaxed)) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(0);
+        }
+        if (pid < 0) {
+            std::cerr << "fork failed: " << strerror(errno) << std::endl;
+            usleep(1000);
+            continue;
+        }
+        waitpid(pid, NULL, 0);
+        forks++;
+    }
+    return forks;
+}
+
+// Pure CPU contention. Returns loop iterations.
+uint64_t cpu_load() {
+    uint64_t iterations = 0;
+    volatile uint64_t sink = 0;
+    while (running.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 1000; ++i) {
+            sink = sink * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        iterations += 1000;
+    }
+    return iterations;
+}
+
+double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    std::string type = "membw";
+    int threads = 1;
+    int duration = 0;
+    int buffer_mb = 0;   // 0 = from the LLC size
+
+    static struct option long_options[] = {
+        {"type", required_argument, 0, 't'},
+        {"threads", required_argument, 0, 'j'},
+        {"duration", required_argument, 0, 'd'},
+        {"buffer-mb", required_argument, 0, 'm'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "t:j:d:m:h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 't':
+                type = optarg;
+                if (type != "membw" && type != "fork" && type != "cpu") {
+                    fprintf(stderr, "Error: unknown load type '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                if (threads <= 0) {
+                    fprintf(stderr, "Error: threads must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'd':
+                duration = atoi(optarg);
+                if (duration < 0) {
+                    fprintf(stderr, "Error: duration must be non-negative\n");
+                    return 1;
+                }
+                break;
+            case 'm':
+                buffer_mb = atoi(optarg);
+                if (buffer_mb <= 0) {
+                    fprintf(stderr, "Error: buffer size must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            case '?':
+                print_usage(argv[0]);
+                return 1;
+            default:
+                abort();
+        }
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    if (duration > 0) {
+        signal(SIGALRM, handle_signal);
+        alarm(duration);
+    }
+
+    // Two buffers per thread; all of them together are 4x the LLC, so each
+    // pass misses it, without 2x256 MiB per thread on many-core hosts
+    if (type == "membw" && buffer_mb == 0) {
+        uint64_t llc = llc_bytes();
+        if (llc == 0) {
+            llc = 64 << 20;
+        }
+        buffer_mb = std::max<uint64_t>(2 * llc / threads >> 20, 8);
+    }
+
+    std::vector<uint64_t> work(threads, 0);
+    std::vector<std::thread> workers;
+    double start = monotonic_seconds();
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i]() {
+            if (type == "membw") {
+                work[i] = memory_bandwidth_load(static_cast<size_t>(buffer_mb) << 20);
+            } else if (type == "fork") {
+                work[i] = fork_load();
+            } else {
+                work[i] = cpu_load();
+            }
+        });
+    }
+
+    // Signals may land on any thread; the workers only poll the flag
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double seconds = monotonic_seconds() - start;
+
+    uint64_t total = 0;
+    for (uint64_t amount : work) {
+        total += amount;
+    }
+    if (type == "membw") {
+        printf("noise membw threads %d buffer_mb %d seconds %.1f copied_gb_per_s %.2f\n", threads, buffer_mb,
+               seconds, total / seconds / (1 << 30));
+    } else if (type == "fork") {
+        printf("noise fork threads %d seconds %.1f forks_per_s %.0f\n", threads, seconds, total / seconds);
+    } else {
+        printf("noise cpu threads %d seconds %.1f\n", threads, seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+#!/bin/bash
+set -e # exit on error
+# set -x # print commands
+
+# Noisy-neighbor benchmark: run each transport's latency benchmark alone and
+# then next to a background load (the other transport's throughput test, a
+# memory-bandwidth hog, a fork storm or CPU spinners), and report how median
+# and p99 latency degrade against the quiet run.
+# Expects socket-benchmark/build and grpc-benchmark/build to exist.
+
+cd "$(dirname "$0")"
+ROOT=$(pwd)/..
+SOCKET_PATH="/tmp/randombytes_socket"
+VICTIMS=${VICTIMS:-"socket grpc"}
+NOISES=${NOISES:-"throughput membw fork cpu"}
+NOISE_THREADS=${NOISE_THREADS:-$(nproc)}
+# A few copying threads already saturate memory bandwidth
+MEMBW_THREADS=${MEMBW_THREADS:-$(( $(nproc) < 4 ? $(nproc) : 4 ))}
+BYTES=32
+ITERATIONS=10000
+EPOCHS=5
+
+# Build the tools if build directory doesn't exist
+if [ ! -d "build" ]; then
+    echo "Building benchmark tools..."
+    mkdir -p build
+    cd build
+    cmake ..
+    make -j$(nproc)
+    cd ..
+fi
+
+cleanup() {
+    echo "Cleaning up..."
+    stop_noise
+    for pid in $SOCKET_PID $GRPC_PID; do
+        kill $pid 2>/dev/null || true
+    done
+    rm -f "$SOCKET_PATH"
+}
+trap cleanup EXIT
+
+# Start a server with a readiness pipe on fd 3 and wait for READY=1
+start_server() {
+    local fifo=$(mktemp -u)
+    mkfifo "$fifo"
+    "$@" 3>"$fifo" > /dev/null &
+    STARTED_PID=$!
+    read -t 30 ready < "$fifo" || true
+    rm -f "$fifo"
+    if [ "$ready" != "READY=1" ]; then
+        echo "Error: $1 failed to start"
+        exit 1
+    fi
+}
+
+# Bulk 1 MiB requests in a loop against one transport
+throughput_load() {
+    while true; do
+        case $1 in
+            socket) "$ROOT/socket-benchmark/build/socket_client" -n 1000 -b 1048576 -q -m persistent -s "$SOCKET_PATH" ;;
+            grpc) "$ROOT/grpc-benchmark/build/randombytes_client" -n 1000 -b 1048576 -q ;;
+        esac
+    done
+}
+
+# Each load runs in its own process group (job control on while it is
+# started), so stop_noise can kill the loop and its running client together
+start_noise() {
+    local noise=$1 victim=$2
+    set -m
+    case $noise in
+        throughput)
+            # The other transport's throughput test
+            local other=socket
+            if [ $victim = socket ]; then
+                other=grpc
+            fi
+            throughput_load $other > /dev/null &
+            ;;
+        membw)
+            ./build/noise -t membw -j $MEMBW_THREADS >> noisy_neighbor_noise.txt &
+            ;;
+        *)
+            ./build/noise -t $noise -j $NOISE_THREADS >> noisy_neighbor_noise.txt &
+            ;;
+    esac
+    NOISE_PID=$!
+    set +m
+    sleep 1 # let the load ramp up
+}
+
+stop_noise() {
+    if [ -n "$NOISE_PID" ]; then
+        kill -- -$NOISE_PID 2>/dev/null || true
+        wait $NOISE_PID 2>/dev/null || true
+        NOISE_PID=""
+    fi
+}
+
+# Latency run of the victim; one result record per epoch
+run_victim() {
+    local victim=$1 noise=$2
+    local output="noisy_${victim}_${noise}.jsonl"
+    rm -f "$output"
+    case $victim in
+        socket)
+            "$ROOT/socket-benchmark/build/socket_client" -n $ITERATIONS -b $BYTES -q -m persistent -s "$SOCKET_PATH" \
+                -W 1000 -E $EPOCHS -o "$output" -L "noise=$noise" > /dev/null
+            ;;
+        grpc)
+            "$ROOT/grpc-benchmark/build/randombytes_client" -n $ITERATIONS -b $BYTES -q \
+                -W 1000 -E $EPOCHS -o "$output" -L "noise=$noise" > /dev/null
+            ;;
+    esac
+}
+
+main() {
+    start_server "$ROOT/socket-benchmark/build/socket_server" -s "$SOCKET_PATH" --ready-fd 3
+    SOCKET_PID=$STARTED_PID
+    start_server "$ROOT/grpc-benchmark/build/randombytes_server" --ready_fd=3
+    GRPC_PID=$STARTED_PID
+
+    rm -f noisy_neighbor.txt
+    for victim in $VICTIMS; do
+        echo "Running $victim alone"
+        run_victim $victim none
+        for noise in $NOISES; do
+            echo "Running $victim next to $noise load"
+            start_noise $noise $victim
+            run_victim $victim $noise
+            stop_noise
+            # Exit status 2 only means latency got worse, which is expected here
+            echo "# $victim with $noise load vs alone" >> noisy_neighbor.txt
+            ./build/analyze_results -B noisy_${victim}_none.jsonl noisy_${victim}_${noise}.jsonl 2>/dev/null |
+                sed -n '/metric/,$p' >> noisy_neighbor.txt || true
+        done
+    done
+
+    echo "Noisy-neighbor benchmark completed. Results saved to tools/noisy_neighbor.txt"
+    grep -E "^#|time_s|p99_us" noisy_neighbor.txt | grep -v configurations
+}
+
+main
@@ -0,0 +1,172 @@
+#!/bin/bash
+set -e # exit on error
+# set -x # print commands
+
+# Placement sweep: pin client and server to CPU pairs at increasing
+# topological distance (same CPU, SMT siblings, cores sharing an L3, cores
+# on different L3s of one package, different packages) and record the
+# latency distribution of each. Placements the machine does not have are
+# skipped; an unpinned run is included for reference.
+# Expects socket-benchmark/build and grpc-benchmark/build to exist.
+
+cd "$(dirname "$0")"
+ROOT=$(pwd)/..
+SOCKET_PATH="/tmp/randombytes_socket"
+BASE_CPU=${BASE_CPU:-0}          # the client's CPU in every placement
+TRANSPORTS=${TRANSPORTS:-"socket grpc"}
+BYTES=32
+ITERATIONS=50000
+
+# Build the tools if build directory doesn't exist
+if [ ! -d "build" ]; then
+    echo "Building benchmark tools..."
+    mkdir -p build
+    cd build
+    cmake ..
+    make -j$(nproc)
+    cd ..
+fi
+
+cleanup() {
+    echo "Cleaning up..."
+    stop_server
+    rm -f "$SOCKET_PATH"
+}
+trap cleanup EXIT
+
+# Start a server with a readiness pipe on fd 3 and wait for READY=1
+start_server() {
+    local fifo=$(mktemp -u)
+    mkfifo "$fifo"
+    "$@" 3>"$fifo" > /dev/null &
+    SERVER_PID=$!
+    read -t 30 ready < "$fifo" || true
+    rm -f "$fifo"
+    if [ "$ready" != "READY=1" ]; then
+        echo "Error: $1 failed to start"
+        exit 1
+    fi
+}
+
+stop_server() {
+    if [ -n "$SERVER_PID" ]; then
+        kill $SERVER_PID 2>/dev/null || true
+        wait $SERVER_PID 2>/dev/null || true
+        SERVER_PID=""
+    fi
+}
+
+# "0-3,8" -> "0 1 2 3 8"
+expand_list() {
+    local range
+    for range in ${1//,/ }; do
+        seq ${range%-*} ${range#*-}
+    done | tr '\n' ' '
+}
+
+in_list() {
+    [[ " $2 " == *" $1 "* ]]
+}
+
+# CPUs sharing the last-level (L3) cache with CPU $1
+l3_cpus() {
+    local index
+    for index in /sys/devices/system/cpu/cpu$1/cache/index*; do
+        if [ "$(cat $index/level 2>/dev/null)" = 3 ]; then
+            expand_list $(cat $index/shared_cpu_list)
+            return
+        fi
+    done
+}
+
+package_of() {
+    cat /sys/devices/system/cpu/cpu$1/topology/physical_package_id
+}
+
+# Fills PLACEMENTS with "name:client_cpu:server_cpu" entries
+find_placements() {
+    local a=$BASE_CPU
+    local online=$(expand_list $(cat /sys/devices/system/cpu/online))
+    local siblings=$(expand_list $(cat /sys/devices/system/cpu/cpu$a/topology/thread_siblings_list))
+    local l3=$(l3_cpus $a)
+    local package=$(package_of $a)
+    local smt="" same_l3="" cross_l3="" cross_socket=""
+
+    for cpu in $online; do
+        if [ $cpu = $a ]; then
+            continue
+        fi
+        if in_list $cpu "$siblings"; then
+            smt=${smt:-$cpu}
+        elif [ -n "$l3" ] && in_list $cpu "$l3"; then
+            same_l3=${same_l3:-$cpu}
+        elif [ "$(package_of $cpu)" = "$package" ]; then
+            # Same package but outside the L3 (another CCX), or no L3 info
+            if [ -n "$l3" ]; then
+                cross_l3=${cross_l3:-$cpu}
+            else
+                same_l3=${same_l3:-$cpu}
+            fi
+        else
+            cross_socket=${cross_socket:-$cpu}
+        fi
+    done
+
+    PLACEMENTS="unpinned:: same_cpu:$a:$a"
+    for name in smt same_l3 cross_l3 cross_socket; do
+        if [ -n "${!name}" ]; then
+            PLACEMENTS="$PLACEMENTS $name:$a:${!name}"
+        else
+            echo "No $name placement on this machine, skipping"
+        fi
+    done
+}
+
+run_placement() {
+    local transport=$1 name=$2 client_cpu=$3 server_cpu=$4
+    local client_pin="" server_pin="" grpc_pin=""
+    if [ -n "$client_cpu" ]; then
+        client_pin="-A $client_cpu"
+        server_pin="-A $server_cpu"
+        grpc_pin="--cpu=$server_cpu"
+    fi
+    local trace="placement_${transport}_${name}.bin"
+
+    case $transport in
+        socket)
+            start_server "$ROOT/socket-benchmark/build/socket_server" -s "$SOCKET_PATH" --ready-fd 3 $server_pin
+            "$ROOT/socket-benchmark/build/socket_client" -n $ITERATIONS -b $BYTES -q -m persistent -s "$SOCKET_PATH" \
+                $client_pin -W 1000 -T "$trace" -o placement.jsonl -L "placement=$name" > /dev/null
+            ;;
+        grpc)
+            start_server "$ROOT/grpc-benchmark/build/randombytes_server" --ready_fd=3 $grpc_pin
+            "$ROOT/grpc-benchmark/build/randombytes_client" -n $ITERATIONS -b $BYTES -q \
+                $client_pin -W 1000 -T "$trace" -o placement.jsonl -L "placement=$name" > /dev/null
+            ;;
+    esac
+    stop_server
+
+    # Keep the full histogram next to the summary line
+    ./build/trace_reader -H "$trace" > "placement_${transport}_${name}.txt"
+    local summary=$(grep "^# mean" "placement_${transport}_${name}.txt" | cut -c 3-)
+    echo "$transport $name ${client_cpu:-any} ${server_cpu:-any} $summary" >> placement.txt
+}
+
+main() {
+    find_placements
+    echo "Placements: $PLACEMENTS"
+
+    for transport in $TRANSPORTS; do
+        for placement in $PLACEMENTS; do
+            IFS=: read name client_cpu server_cpu <<< "$placement"
+            echo "Running $transport with placement $name (client ${client_cpu:-any}, server ${server_cpu:-any})"
+            run_placement $transport $name "$client_cpu" "$server_cpu"
+        done
+    done
+
+    echo "Placement benchmark completed. Results saved to tools/placement.txt"
+    echo "(transport placement client_cpu server_cpu mean .. p50 .. p90 .. p99 .. p99.9 .. max .. in ns)"
+    tail -n $(( $(echo $TRANSPORTS | wc -w) * $(echo $PLACEMENTS | wc -w) )) placement.txt
+}
+
+main
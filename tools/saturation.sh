@@ -0,0 +1,141 @@
+#!/bin/bash
+set -e # exit on error
+# set -x # print commands
+
+# Saturation search: for each transport and request size, binary-search the
+# open-loop request rate (client -r) for the highest rate at which p99
+# latency, measured from each request's scheduled time, stays under an SLO.
+# That rate is the knee of the latency-throughput curve.
+# Expects socket-benchmark/build and grpc-benchmark/build to exist.
+
+cd "$(dirname "$0")"
+ROOT=$(pwd)/..
+SOCKET_PATH="/tmp/randombytes_socket"
+TRANSPORTS=${TRANSPORTS:-"socket grpc"}
+SIZES=${SIZES:-"32 1024 65536"}
+SLO_US=${SLO_US:-100}            # p99 target in microseconds
+THREADS=${THREADS:-4}            # client threads, one connection each
+DURATION=${DURATION:-2}          # seconds per probe
+LOW=${LOW:-1000}                 # first rate probed, requests/s
+HIGH=${HIGH:-1000000}            # stop doubling here
+
+cleanup() {
+    echo "Cleaning up..."
+    for pid in $SOCKET_PID $GRPC_PID; do
+        kill $pid 2>/dev/null || true
+    done
+    rm -f "$SOCKET_PATH"
+}
+trap cleanup EXIT
+
+# Start a server with a readiness pipe on fd 3 and wait for READY=1
+start_server() {
+    local fifo=$(mktemp -u)
+    mkfifo "$fifo"
+    "$@" 3>"$fifo" > /dev/null &
+    STARTED_PID=$!
+    read -t 30 ready < "$fifo" || true
+    rm -f "$fifo"
+    if [ "$ready" != "READY=1" ]; then
+        echo "Error: $1 failed to start"
+        exit 1
+    fi
+}
+
+in_list() {
+    [[ " $2 " == *" $1 "* ]]
+}
+
+# Run one open-loop probe and set P50_NS, P99_NS, ACHIEVED and PASS
+probe() {
+    local transport=$1 B=$2 rate=$3
+    local n=$(( rate * DURATION ))
+    if [ $n -lt 1000 ]; then
+        n=1000
+    fi
+    local output
+    case $transport in
+        socket)
+            output=$("$ROOT/socket-benchmark/build/socket_client" -q -m persistent -s "$SOCKET_PATH" \
+                -n $n -b $B -r $rate -j $THREADS || true)
+            ;;
+        grpc)
+            output=$("$ROOT/grpc-benchmark/build/randombytes_client" -q -n $n -b $B -r $rate -j $THREADS || true)
+            ;;
+    esac
+    P50_NS=$(echo "$output" | awk '/^replay latency_ns/ {print $4}')
+    P99_NS=$(echo "$output" | awk '/^replay latency_ns/ {print $8}')
+    ACHIEVED=$(echo "$output" | awk '/^open_loop/ {print $5}')
+    local failed=$(echo "$output" | awk '/^replay requests/ {print $7}')
+
+    # Sustainable: p99 within the SLO, no failures, and the client kept up
+    PASS=no
+    if [ -n "$P99_NS" ] && [ "${failed:-1}" = 0 ] && [ $P99_NS -le $(( SLO_US * 1000 )) ] &&
+       [ $(( ACHIEVED * 100 )) -ge $(( rate * 95 )) ]; then
+        PASS=yes
+    fi
+    echo "$transport $B $rate ${ACHIEVED:-0} ${P50_NS:-0} ${P99_NS:-0} $PASS" >> saturation_curve.txt
+    echo "  $rate/s: achieved ${ACHIEVED:-0}/s, p99 $(( ${P99_NS:-0} / 1000 )) us -> $PASS"
+}
+
+# Double the rate from LOW until a probe fails, so an overloaded server only
+# has to drain one short overshoot, then bisect geometrically until the
+# passing and failing rates are within 5%
+search() {
+    local transport=$1 B=$2
+    local low=0 high=$LOW p99_at_low=""
+
+    while true; do
+        probe $transport $B $high
+        if [ $PASS = no ]; then
+            break
+        fi
+        low=$high
+        p99_at_low=$P99_NS
+        if [ $high -ge $HIGH ]; then
+            echo "$transport $B $low $p99_at_low at_least" >> saturation.txt
+            return
+        fi
+        high=$(( high * 2 < HIGH ? high * 2 : HIGH ))
+    done
+    if [ $low = 0 ]; then
+        echo "$transport $B 0 - below_low" >> saturation.txt
+        return
+    fi
+
+    while [ $(( high * 100 )) -gt $(( low * 105 )) ]; do
+        local mid=$(awk -v l=$low -v h=$high 'BEGIN {printf "%.0f", sqrt(l * h)}')
+        probe $transport $B $mid
+        if [ $PASS = yes ]; then
+            low=$mid
+            p99_at_low=$P99_NS
+        else
+            high=$mid
+        fi
+    done
+    echo "$transport $B $low $p99_at_low knee" >> saturation.txt
+}
+
+main() {
+    if in_list socket "$TRANSPORTS"; then
+        start_server "$ROOT/socket-benchmark/build/socket_server" -s "$SOCKET_PATH" --ready-fd 3
+        SOCKET_PID=$STARTED_PID
+    fi
+    if in_list grpc "$TRANSPORTS"; then
+        start_server "$ROOT/grpc-benchmark/build/randombytes_server" --ready_fd=3
+        GRPC_PID=$STARTED_PID
+    fi
+
+    for transport in $TRANSPORTS; do
+        for B in $SIZES; do
+            echo "Searching $transport, $B bytes per call, p99 SLO $SLO_US us"
+            search $transport $B
+        done
+    done
+
+    echo "Saturation search completed. Results saved to tools/saturation.txt"
+    echo "(transport bytes max_requests_per_s p99_ns result; every probe is in saturation_curve.txt)"
+    tail -n $(( $(echo $TRANSPORTS | wc -w) * $(echo $SIZES | wc -w) )) saturation.txt
+}
+
+main
@@ -0,0 +1,187 @@
+/*
+ * Trace file reader
+ * Converts a client's binary per-call trace (--trace-file) to CSV, or
+ * prints a latency histogram and percentiles
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include "histogram.h"
+#include "trace_file.h"
+
+void print_usage(const char *program_name) {
+    printf("Usage: %s [OPTIONS] TRACE_FILE\n", program_name);
+    printf("Options:\n");
+    printf("  -H, --histogram         Print a log2 latency histogram and percentiles instead of CSV\n");
+    printf("  -a, --all               Include failed calls in the histogram\n");
+    printf("  -h, --help              Show this help message\n");
+    printf("\n");
+    printf("CSV columns: start_ns,latency_ns,bytes,status (0 = ok, 1 = failed)\n");
+}
+
+// Read and validate the whole file
+bool read_trace(const char* path, TraceFileHeader* header, std::vector<TraceRecord>& records) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        std::cerr << "Failed to open " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    bool ok = fread(header, sizeof(*header), 1, file) == 1 &&
+              memcmp(header->magic, TRACE_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+              header->record_size == sizeof(TraceRecord);
+    if (!ok) {
+        std::cerr << path << " is not a trace file of this version" << std::endl;
+        fclose(file);
+        return false;
+    }
+
+    // Records are written in order into a zero-filled file, so in a trace
+    // the client never closed every record up to the last non-zero one is real
+    bool closed = header->num_records > 0;
+    if (closed) {
+        records.resize(header->num_records);
+        records.resize(fread(records.data(), sizeof(TraceRecord), records.size(), file));
+    } else {
+        TraceRecord record;
+        while (fread(&record, sizeof(record), 1, file) == 1) {
+            records.push_back(record);
+        }
+    }
+    fclose(file);
+
+    if (!closed) {
+        static const TraceRecord kEmpty = {};
+        size_t capacity = records.size();
+        while (!records.empty() && memcmp(&records.back(), &kEmpty, sizeof(kEmpty)) == 0) {
+            records.pop_back();
+        }
+        if (capacity > 0) {
+            std::cerr << "Trace truncated: client did not finish, " << records.size() << " of "
+                      << capacity << " records written" << std::endl;
+        }
+    } else if (records.size() != header->num_records) {
+        // The file was cut short after the client closed it; keep what is there
+        std::cerr << "Trace truncated: " << records.size() << " of " << header->num_records
+                  << " records" << std::endl;
+    }
+    return true;
+}
+
+void print_histogram(const TraceFileHeader& header, const std::vector<TraceRecord>& records,
+                     bool include_failed) {
+    Log2Histogram histogram;
+    uint64_t failed = 0;
+    for (const TraceRecord& record : records) {
+        if (record.status != 0) {
+            failed++;
+            if (!include_failed) {
+                continue;
+            }
+        }
+        histogram.Record(record.latency_ns);
+    }
+
+    char transport[sizeof(header.transport) + 1] = {};
+    memcpy(transport, header.transport, sizeof(header.transport));
+    printf("# %s: %llu calls, %llu failed\n", transport,
+           static_cast<unsigned long long>(records.size()), static_cast<unsigned long long>(failed));
+    if (histogram.count() == 0) {
+        return;
+    }
+
+    printf("%14s %14s %10s %8s\n", "from_ns", "to_ns", "count", "cum_%");
+    uint64_t cumulative = 0;
+    for (int b = 0; b < Log2Histogram::kBuckets; ++b) {
+        uint64_t count = histogram.bucket(b);
+        if (count == 0) {
+            continue;
+        }
+        cumulative += count;
+        uint64_t from = b == 0 ? 0 : Log2Histogram::BucketUpperBound(b - 1) + 1;
+        printf("%14llu %14llu %10llu %7.2f%%\n",
+               static_cast<unsigned long long>(from),
+               static_cast<unsigned long long>(Log2Histogram::BucketUpperBound(b)),
+               static_cast<unsigned long long>(count), 100.0 * cumulative / histogram.count());
+    }
+
+    // Exact percentiles from the records themselves
+    std::vector<uint64_t> latencies;
+    latencies.reserve(histogram.count());
+    for (const TraceRecord& record : records) {
+        if (record.status == 0 || include_failed) {
+            latencies.push_back(record.latency_ns);
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    size_t n = latencies.size();
+    printf("# mean %.0f p50 %llu p90 %llu p99 %llu p99.9 %llu max %llu\n", histogram.Mean(),
+           static_cast<unsigned long long>(latencies[n / 2]),
+           static_cast<unsigned long long>(latencies[n * 90 / 100]),
+           static_cast<unsigned long long>(latencies[n * 99 / 100]),
+           static_cast<unsigned long long>(latencies[n * 999 / 1000]),
+           static_cast<unsigned long long>(latencies[n - 1]));
+}
+
+int main(int argc, char** argv) {
+    bool histogram = false;
+    bool include_failed = false;
+
+    static struct option long_options[] = {
+        {"histogram", no_argument, 0, 'H'},
+        {"all", no_argument, 0, 'a'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "Hah", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'H':
+                histogram = true;
+                break;
+            case 'a':
+                include_failed = true;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            case '?':
+                print_usage(argv[0]);
+                return 1;
+            default:
+                abort();
+        }
+    }
+
+    if (optind != argc - 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    TraceFileHeader header;
+    std::vector<TraceRecord> records;
+    if (!read_trace(argv[optind], &header, records)) {
+        return 1;
+    }
+
+    if (histogram) {
+        print_histogram(header, records, include_failed);
+        return 0;
+    }
+
+    printf("start_ns,latency_ns,bytes,status\n");
+    for (const TraceRecord& record : records) {
+        printf("%llu,%llu,%u,%u\n", static_cast<unsigned long long>(record.start_ns),
+               static_cast<unsigned long long>(record.latency_ns), record.bytes, record.status);
+    }
+    return 0;
+}